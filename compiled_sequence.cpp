@@ -0,0 +1,170 @@
+#include "compiled_sequence.h"
+#include "core.h"
+
+namespace {
+
+uint64_t gcd(uint64_t a, uint64_t b)
+{
+    while (b) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+} // namespace
+
+CompiledSequence::CompiledSequence(int size)
+    : m_to(6 * (size_t)size * size), m_size(size), m_hasCubie(size == 3)
+{
+    for (size_t p = 0; p < m_to.size(); ++p) m_to[p] = (uint16_t)p;
+}
+
+CompiledSequence CompiledSequence::compile(const LayerTurn* turns, size_t count, int size)
+{
+    // Core's sticker i starts on facelet i, so where the stickers end up is the permutation
+    Core scratch(1.0f, 0.0f, 360.0f, size);
+    scratch.applySequence(turns, count);
+    CompiledSequence r(size);
+    scratch.writeStickerFacelets(r.m_to.data());
+    r.updateCubie();
+    return r;
+}
+
+CompiledSequence CompiledSequence::compile(const Move* moves, size_t count, int size)
+{
+    if (size == 3) {
+        CompiledSequence r(size);
+        r.m_cubie.applySequence(moves, count);
+        uint8_t src[54];
+        r.m_cubie.toFaceletPermutation(src);
+        for (int p = 0; p < 54; ++p) r.m_to[src[p]] = (uint16_t)p;
+        return r;
+    }
+    std::vector<LayerTurn> turns(count);
+    for (size_t i = 0; i < count; ++i) turns[i] = layerTurnFromMove(moves[i], size);
+    return compile(turns.data(), turns.size(), size);
+}
+
+bool CompiledSequence::compile(const std::string& moves, int size, CompiledSequence& out)
+{
+    std::vector<LayerTurn> turns;
+    if (!parseLayerTurnSequence(moves, size, turns)) return false;
+    out = compile(turns.data(), turns.size(), size);
+    return true;
+}
+
+int CompiledSequence::size() const
+{
+    return m_size;
+}
+
+size_t CompiledSequence::faceletCount() const
+{
+    return m_to.size();
+}
+
+uint16_t CompiledSequence::to(size_t facelet) const
+{
+    return m_to[facelet];
+}
+
+bool CompiledSequence::isIdentity() const
+{
+    for (size_t p = 0; p < m_to.size(); ++p)
+        if (m_to[p] != p) return false;
+    return true;
+}
+
+bool CompiledSequence::hasCubie() const
+{
+    return m_hasCubie;
+}
+
+const CubieCube& CompiledSequence::cubie() const
+{
+    return m_cubie;
+}
+
+void CompiledSequence::updateCubie()
+{
+    // the colors the sequence leaves on a solved cube describe it exactly on 3x3: corner and
+    // edge stickers are told apart by their cubie colors, and centres must stay put
+    m_hasCubie = false;
+    if (m_size != 3) return;
+    uint8_t colors[54];
+    for (int p = 0; p < 54; ++p) colors[m_to[p]] = (uint8_t)(p / 9);
+    m_hasCubie = CubieCube::fromFacelets(colors, m_cubie);
+}
+
+bool CompiledSequence::then(const CompiledSequence& b)
+{
+    if (b.m_size != m_size) return false;
+    if (&b == this) {
+        CompiledSequence copy = b; // squaring: don't read what is being overwritten
+        return then(copy);
+    }
+    for (uint16_t& q : m_to) q = b.m_to[q];
+    if (m_hasCubie && b.m_hasCubie) {
+        m_cubie.multiply(b.m_cubie);
+    } else {
+        updateCubie();
+    }
+    return true;
+}
+
+CompiledSequence CompiledSequence::inverse() const
+{
+    CompiledSequence r(m_size);
+    for (size_t p = 0; p < m_to.size(); ++p) r.m_to[m_to[p]] = (uint16_t)p;
+    r.m_hasCubie = m_hasCubie;
+    if (m_hasCubie) r.m_cubie = m_cubie.inverse();
+    return r;
+}
+
+CompiledSequence CompiledSequence::power(int64_t k) const
+{
+    CompiledSequence base = k < 0 ? inverse() : *this;
+    uint64_t e = k < 0 ? 0 - (uint64_t)k : (uint64_t)k;
+    CompiledSequence r(m_size);
+    while (e) {
+        if (e & 1) r.then(base);
+        e >>= 1;
+        if (e) base.then(base);
+    }
+    return r;
+}
+
+uint64_t CompiledSequence::order() const
+{
+    std::vector<uint8_t> seen(m_to.size(), 0);
+    uint64_t order = 1;
+    for (size_t p = 0; p < m_to.size(); ++p) {
+        if (seen[p]) continue;
+        uint64_t len = 0;
+        for (size_t q = p; !seen[q]; q = m_to[q]) {
+            seen[q] = 1;
+            ++len;
+        }
+        order = order / gcd(order, len) * len;
+    }
+    return order;
+}
+
+void CompiledSequence::permuteColors(const uint8_t* in, uint8_t* out) const
+{
+    for (size_t p = 0; p < m_to.size(); ++p) out[m_to[p]] = in[p];
+}
+
+bool CompiledSequence::applyTo(CubieCube& state) const
+{
+    if (!m_hasCubie) return false;
+    state.multiply(m_cubie);
+    return true;
+}
+
+bool CompiledSequence::operator==(const CompiledSequence& o) const
+{
+    return m_size == o.m_size && m_to == o.m_to;
+}
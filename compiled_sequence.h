@@ -0,0 +1,76 @@
+#ifndef COMPILED_SEQUENCE_H
+#define COMPILED_SEQUENCE_H
+
+// CompiledSequence - a move sequence folded into one permutation of the facelets ("macro move")
+// - Compiled once from turns, moves or text for a given cube size; applying it to a Core, a
+//   CubieCube or a color array is then one pass, whatever the sequence length
+// - to(p) = facelet where the sticker resting on facelet p ends up, so stickers are tracked
+//   individually (centres and same-colored stickers included)
+// - On 3x3, a sequence that leaves the centres home also keeps its CubieCube, and Core's
+//   cubie path applies it with one CubieCube::multiply()
+// - Sequences of one size form a group: then() composes, inverse(), power(), order()
+// Usage:
+//   CompiledSequence sexy;
+//   CompiledSequence::compile("R U R' U'", 3, sexy);
+//   uint64_t n = sexy.order();                    // 6
+//   CompiledSequence back = sexy.power(5);        // == sexy.inverse()
+//   core.applyCompiled(sexy);                     // headless, one step
+//
+// No GL; compiling replays the turns once on a headless Core of that size.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cubie.h"
+#include "move.h"
+
+class CompiledSequence {
+public:
+    // the identity of a size x size cube
+    explicit CompiledSequence(int size = 3);
+
+    static CompiledSequence compile(const LayerTurn* turns, size_t count, int size);
+    static CompiledSequence compile(const Move* moves, size_t count, int size);
+    // Parse with parseLayerTurnSequence(). Returns false (out untouched) if the text isn't valid
+    // for size.
+    static bool compile(const std::string& moves, int size, CompiledSequence& out);
+
+    int size() const;
+    size_t faceletCount() const;        // 6 * size * size
+    uint16_t to(size_t facelet) const;
+    bool isIdentity() const;
+
+    // true if a CubieCube equivalent exists (3x3, centres home); cubie() is that state
+    bool hasCubie() const;
+    const CubieCube& cubie() const;
+
+    // this followed by b (same size, else *this unchanged and false)
+    bool then(const CompiledSequence& b);
+    CompiledSequence inverse() const;
+    // k applications (k < 0 applies the inverse), by repeated squaring
+    CompiledSequence power(int64_t k) const;
+    // smallest k > 0 with power(k) the identity: lcm of the sticker cycle lengths. Where stickers
+    // of one color are interchangeable (big cube centres) the colors may repeat sooner.
+    uint64_t order() const;
+
+    // colors after the sequence, given colors before (layout of Core::writeFaceletColors());
+    // in and out must not overlap
+    void permuteColors(const uint8_t* in, uint8_t* out) const;
+    // state = state followed by the sequence; false (untouched) unless hasCubie()
+    bool applyTo(CubieCube& state) const;
+
+    bool operator==(const CompiledSequence& o) const;
+    bool operator!=(const CompiledSequence& o) const { return !(*this == o); }
+
+private:
+    void updateCubie();
+
+    std::vector<uint16_t> m_to;
+    CubieCube m_cubie;
+    int m_size = 3;
+    bool m_hasCubie = true;
+};
+
+#endif // COMPILED_SEQUENCE_H
@@ -1,90 +1,181 @@
 #include "core.h"
+#include "compiled_sequence.h"
+#include "move_log.h"
+#include "zobrist.h"
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
 #include <cmath>
 #include <algorithm>
+#include <mutex>
 
 // Constants for face order in getSticker*:
-// We'll create stickers in this stable order: U (y=+1), R (x=+1), F (z=+1),
-// D (y=-1), L (x=-1), B (z=-1) -- each with 9 stickers row-major (-1..1 x, -1..1 z)
+// We'll create stickers in this stable order: U (y=+), R (x=+), F (z=+),
+// D (y=-), L (x=-), B (z=-) -- each with N*N stickers row-major (see homeFacelet)
 static const char FACE_ORDER[6] = { 'U', 'R', 'F', 'D', 'L', 'B' };
-
-Core::Core(float cubieSize, float gap, float animSpeedDegPerSec)
-    : m_cubieSize(cubieSize), m_gap(gap), m_anim(), m_spacing(cubieSize + gap)
+// outward normal of each face, in FACE_ORDER; the opposite of face f is f + 3 (mod 6)
+static const glm::ivec3 FACE_NORMAL[6] = {
+    glm::ivec3(0, 1, 0), glm::ivec3(1, 0, 0), glm::ivec3(0, 0, 1),
+    glm::ivec3(0, -1, 0), glm::ivec3(-1, 0, 0), glm::ivec3(0, 0, -1)
+};
+// Conventional coloring, by color id (= home face):
+// U = white, R = green, F = red, D = yellow, L = blue, B = orange
+static const glm::vec3 PALETTE[6] = {
+    glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.05f, 0.7f, 0.05f), glm::vec3(0.8f, 0.05f, 0.05f),
+    glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.05f, 0.15f, 0.9f), glm::vec3(1.0f, 0.5f, 0.0f)
+};
+
+// sticker indices (and layer list slots) are stored as uint16_t
+static_assert(6 * Core::kMaxSize * Core::kMaxSize <= 65536, "sticker indices must fit uint16_t");
+
+static int stickerFace(const PackedSticker& s) { return s.faceColor & 7; }
+static int stickerColor(const PackedSticker& s) { return s.faceColor >> 3; }
+
+Core::Core(float cubieSize, float gap, float animSpeedDegPerSec, int size)
+    : m_cubieSize(cubieSize), m_gap(gap), m_spacing(cubieSize + gap),
+      m_size(std::min(std::max(size, kMinSize), kMaxSize)), m_animSpeedDeg(animSpeedDegPerSec), m_queue(4096),
+      m_submissions(new MpscQueue<LayerTurn>(4096))
 {
-    m_anim.speedDeg = animSpeedDegPerSec;
+    m_cubieValid = m_size == 3;
     buildInitialStickers();
+
+    size_t count = m_stickers.size();
+    for (int ax = 0; ax < 3; ++ax) {
+        m_layerMembers[ax].resize(m_size);
+        m_memberSlot[ax].resize(count);
+        // an outer layer holds a full face plus a ring of edge stickers
+        for (auto &members : m_layerMembers[ax]) members.reserve(m_size * m_size + 4 * m_size);
+        rebuildLayerIndex(ax);
+    }
 }
 
-void Core::buildInitialStickers()
+int Core::size() const
+{
+    return m_size;
+}
+
+int Core::layerOf(int coord) const
+{
+    return (coord + m_size - 1) / 2;
+}
+
+void Core::rebuildLayerIndex(int axisIdx)
+{
+    for (auto &members : m_layerMembers[axisIdx]) members.clear(); // keeps capacity
+    for (size_t i = 0; i < m_stickers.size(); ++i) {
+        auto &members = m_layerMembers[axisIdx][layerOf(m_stickers[i].pos[axisIdx])];
+        m_memberSlot[axisIdx][i] = (uint16_t)members.size();
+        members.push_back((uint16_t)i);
+    }
+}
+
+void Core::moveLayerMember(int axisIdx, uint16_t idx, int fromLayer, int toLayer)
+{
+    if (fromLayer == toLayer) return;
+    // swap-remove from the old list, append to the new one
+    auto &from = m_layerMembers[axisIdx][fromLayer];
+    uint16_t slot = m_memberSlot[axisIdx][idx];
+    uint16_t last = from.back();
+    from[slot] = last;
+    m_memberSlot[axisIdx][last] = slot;
+    from.pop_back();
+
+    auto &to = m_layerMembers[axisIdx][toLayer];
+    m_memberSlot[axisIdx][idx] = (uint16_t)to.size();
+    to.push_back(idx);
+}
+
+// Resting place of facelet `index` (face * N*N + row-major cell) on a solved size x size cube:
+// sets s's position (doubled centred coordinates) and face, keeping its color id. Sticker i of
+// buildInitialStickers() starts here, and on 3x3 CubieCube's facelet views use the same numbering.
+static void homeFacelet(int index, int size, PackedSticker& s)
+{
+    int cells = size * size;
+    int f = index / cells;
+    char face = FACE_ORDER[f];
+    int a = 2 * ((index % cells) / size) - (size - 1);
+    int b = 2 * ((index % cells) % size) - (size - 1);
+    int fixCoord = f < 3 ? +(size - 1) : -(size - 1); // U R F sit on the + side
+
+    // Determine cubePos depending on face:
+    // We'll map (a,b) to the two free axes. We'll pick consistent mapping:
+    // For U/D: a => x, b => -z (so top-left is (-1,1))
+    // For F/B: a => x, b => -y
+    // For R/L: a => z, b => -y
+    glm::ivec3 cubePos;
+    if (face == 'U' || face == 'D') {
+        cubePos = glm::ivec3(a, fixCoord, -b);
+    } else if (face == 'F' || face == 'B') {
+        cubePos = glm::ivec3(a, -b, fixCoord);
+    } else { // R or L
+        cubePos = glm::ivec3(fixCoord, -b, a);
+    }
+    for (int c = 0; c < 3; ++c) s.pos[c] = (int8_t)cubePos[c];
+    s.faceColor = (uint8_t)((s.faceColor & ~7) | f);
+}
+
+// Inverse of homeFacelet(): the facelet index sticker s occupies. Table-driven rather than
+// branching on the face, since the stickers of one turn sit on four different faces
+// (a = s.pos[A_AXIS[face]], b = -s.pos[B_AXIS[face]], see homeFacelet()).
+static int faceletIndex(const PackedSticker& s, int size)
 {
-    m_stickers.clear();
-    m_stickers.reserve(54);
-
-    // For each face in stable order create 9 stickers.
-    for (int fi = 0; fi < 6; ++fi) {
-        char face = FACE_ORDER[fi];
-        glm::ivec3 normal(0);
-        int fixCoord = 0;
-        if (face == 'U') { normal = glm::ivec3(0, 1, 0); fixCoord = +1; }
-        if (face == 'D') { normal = glm::ivec3(0, -1, 0); fixCoord = -1; }
-        if (face == 'F') { normal = glm::ivec3(0, 0, 1); fixCoord = +1; }
-        if (face == 'B') { normal = glm::ivec3(0, 0, -1); fixCoord = -1; }
-        if (face == 'R') { normal = glm::ivec3(1, 0, 0); fixCoord = +1; }
-        if (face == 'L') { normal = glm::ivec3(-1, 0, 0); fixCoord = -1; }
-
-        // iterate 3x3 grid for that face
-        for (int a = -1; a <= 1; ++a) {
-            for (int b = -1; b <= 1; ++b) {
-                Sticker s;
-                s.color = faceToColor(face);
-                // Determine cubePos depending on face:
-                // We'll map (a,b) to the two free axes. We'll pick consistent mapping:
-                // For U/D: a => x, b => -z (so top-left is (-1,1))
-                // For F/B: a => x, b => -y
-                // For R/L: a => z, b => -y
-                if (face == 'U' || face == 'D') {
-                    s.cubePos = glm::ivec3(a, fixCoord, -b);
-                } else if (face == 'F' || face == 'B') {
-                    s.cubePos = glm::ivec3(a, -b, fixCoord);
-                } else { // R or L
-                    s.cubePos = glm::ivec3(fixCoord, -b, a);
+    static const int8_t A_AXIS[6] = { 0, 2, 0, 0, 2, 0 };
+    static const int8_t B_AXIS[6] = { 2, 1, 1, 2, 1, 1 };
+    int face = stickerFace(s);
+    int a = s.pos[A_AXIS[face]], b = -s.pos[B_AXIS[face]];
+    return face * size * size + ((a + size - 1) >> 1) * size + ((b + size - 1) >> 1);
+}
+
+// face[axis][q][f]: where face f points after q quarter turns (counter-clockwise)
+// about +axis, from the same (u, v) -> (-v, u) step the positions take
+struct FaceTurnTable {
+    uint8_t face[3][4][6];
+
+    FaceTurnTable()
+    {
+        static const int8_t FACES[27] = { // face of a normal, by (n.x + 1) + 3 * (n.y + 1) + 9 * (n.z + 1)
+            -1, -1, -1, -1, 5, -1, -1, -1, -1,
+            -1, 3, -1, 4, -1, 1, -1, 0, -1,
+            -1, -1, -1, -1, 2, -1, -1, -1, -1
+        };
+        for (int ax = 0; ax < 3; ++ax) {
+            int u = (ax + 1) % 3, v = (ax + 2) % 3;
+            for (int f = 0; f < 6; ++f) {
+                glm::ivec3 n = FACE_NORMAL[f];
+                for (int q = 0; q < 4; ++q) {
+                    face[ax][q][f] = (uint8_t)FACES[(n.x + 1) + 3 * (n.y + 1) + 9 * (n.z + 1)];
+                    int nu = n[u]; n[u] = -n[v]; n[v] = nu;
                 }
-                s.normal = normal;
-                rebuildBaseModel(s);
-                m_stickers.push_back(s);
             }
         }
     }
+};
+static const FaceTurnTable& faceTurnTable()
+{
+    static const FaceTurnTable table;
+    return table;
 }
 
-glm::vec3 Core::faceToColor(char face) const
+// zobristKey(size, facelet, color) at [facelet * 6 + color], built once per size and shared
+static const uint64_t* zobristTable(int size)
 {
-    // Conventional coloring:
-    // U = white, D = yellow, F = red, B = orange, R = green, L = blue
-    switch (face) {
-        case 'U': return glm::vec3(1.0f, 1.0f, 1.0f);
-        case 'D': return glm::vec3(1.0f, 1.0f, 0.0f);
-        case 'F': return glm::vec3(0.8f, 0.05f, 0.05f);
-        case 'B': return glm::vec3(1.0f, 0.5f, 0.0f);
-        case 'R': return glm::vec3(0.05f, 0.7f, 0.05f);
-        case 'L': return glm::vec3(0.05f, 0.15f, 0.9f);
-    }
-    return glm::vec3(0.2f);
+    static std::once_flag once[Core::kMaxSize + 1];
+    static std::vector<uint64_t> tables[Core::kMaxSize + 1];
+    std::call_once(once[size], [size] {
+        std::vector<uint64_t>& t = tables[size];
+        t.resize(6 * (size_t)size * size * 6);
+        for (size_t i = 0; i < t.size(); ++i) t[i] = zobristKey(size, (int)(i / 6), (int)(i % 6));
+    });
+    return tables[size].data();
 }
 
-void Core::rebuildBaseModel(Sticker& s)
+// Rotation * scale of a sticker quad facing along `normal`, i.e. its base model without the
+// translation. Only the six axis normals occur, so Core evaluates this once per face.
+static glm::mat4 stickerOrientation(const glm::ivec3& normal, float cubieSize)
 {
-    // Build a model matrix for the sticker quad when no animation is happening.
-    // Place the sticker slightly offset from the cubie surface along its normal.
-    glm::vec3 pos = glm::vec3(s.cubePos) * m_spacing;
-    float offset = 0.5f * m_cubieSize + 0.001f; // slightly out from cubie surface
-    pos += glm::vec3(s.normal) * offset;
-
-    // We want the sticker quad to face outward along s.normal.
+    // We want the sticker quad to face outward along the normal.
     glm::vec3 zDir = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 n = glm::normalize(glm::vec3(s.normal));
+    glm::vec3 n = glm::normalize(glm::vec3(normal));
     glm::quat q;
     if (glm::length(glm::cross(zDir, n)) < 1e-4f) {
         // parallel or anti-parallel
@@ -97,30 +188,89 @@ void Core::rebuildBaseModel(Sticker& s)
     }
 
     // scale of sticker quad relative to cubie face (leave tiny margin)
-    float stickerScale = m_cubieSize * 0.92f;
-    glm::mat4 M = glm::translate(glm::mat4(1.0f), pos) * glm::toMat4(q) * glm::scale(glm::mat4(1.0f), glm::vec3(stickerScale, stickerScale, 1.0f));
-    s.baseModel = M;
+    float stickerScale = cubieSize * 0.92f;
+    return glm::toMat4(q) * glm::scale(glm::mat4(1.0f), glm::vec3(stickerScale, stickerScale, 1.0f));
+}
+
+void Core::buildInitialStickers()
+{
+    for (int f = 0; f < 6; ++f) {
+        m_geometry.orientation[f] = stickerOrientation(FACE_NORMAL[f], m_cubieSize);
+        m_geometry.normal[f] = glm::vec3(FACE_NORMAL[f]);
+    }
+    m_geometry.halfSpacing = 0.5f * m_spacing;                // undo the doubling
+    m_geometry.surfaceOffset = 0.5f * m_cubieSize + 0.001f;   // slightly out from cubie surface
+
+    // For each face in stable order create N*N stickers (row-major).
+    size_t count = 6 * (size_t)m_size * m_size;
+    m_stickers.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_stickers[i].faceColor = (uint8_t)((i / ((size_t)m_size * m_size)) << 3);
+        homeFacelet((int)i, m_size, m_stickers[i]);
+    }
+    m_zobrist = zobristTable(m_size);
+    m_stickerKey.resize(count);
+    m_hash = 0;
+    for (size_t i = 0; i < count; ++i) {
+        m_stickerKey[i] = m_zobrist[i * 6 + stickerColor(m_stickers[i])];
+        m_hash ^= m_stickerKey[i];
+    }
+}
+
+void Core::writeBaseModel(size_t idx, glm::mat4& M) const
+{
+    // Model matrix for the sticker quad when no animation is happening: the face's
+    // orientation (rotation * scale, from the table) translated into place, slightly offset
+    // from the cubie surface along its normal.
+    const PackedSticker &s = m_stickers[idx];
+    int face = stickerFace(s);
+    const glm::vec3 &n = m_geometry.normal[face];
+    float hs = m_geometry.halfSpacing, offset = m_geometry.surfaceOffset;
+
+    // translate(pos) * M only replaces M's last column, since M has no translation. Written
+    // component-wise straight into M: this runs per sticker per export, and assembling a
+    // glm::vec4 first costs a store-forwarding stall each time.
+    const glm::mat4 &O = m_geometry.orientation[face];
+    M[0] = O[0];
+    M[1] = O[1];
+    M[2] = O[2];
+    M[3][0] = s.pos[0] * hs + n.x * offset;
+    M[3][1] = s.pos[1] * hs + n.y * offset;
+    M[3][2] = s.pos[2] * hs + n.z * offset;
+    M[3][3] = 1.0f;
 }
 
 void Core::update(float deltaSeconds)
 {
-    // progress animation if any
-    if (m_anim.active) {
-        float step = m_anim.speedDeg * deltaSeconds;
-        float remaining = std::abs(m_anim.targetAngle - m_anim.currentAngle);
-        float take = std::min(step, remaining);
-        // advance in the sign of targetAngle
-        m_anim.currentAngle += (m_anim.targetAngle >= 0.0f ? 1.0f : -1.0f) * take;
-
-        if (std::abs(std::abs(m_anim.currentAngle) - std::abs(m_anim.targetAngle)) < 1e-3f ||
-            remaining <= 1e-4f) {
-            // finish
-            float finalAngle = m_anim.targetAngle; // may be ±90 or 180
-            applyRotationDiscrete(m_anim.axis, m_anim.layer, finalAngle);
-            m_anim.active = false;
-            m_anim.currentAngle = 0.0f;
-            startNextInQueue();
+    m_clock += deltaSeconds;
+    drainSubmissions();
+    catchUpBacklog();
+
+    // progress the running animations if any
+    if (m_animCount > 0) {
+        float step = m_animSpeedDeg * m_speedScale * deltaSeconds;
+        bool landed = false;
+        for (int i = 0; i < m_animCount;) {
+            Anim &a = m_anims[i];
+            float remaining = std::abs(a.targetAngle - a.currentAngle);
+            float take = std::min(step, remaining);
+            // advance in the sign of targetAngle
+            a.currentAngle += (a.targetAngle >= 0.0f ? 1.0f : -1.0f) * take;
+            if (take > 0.0f) markTransformsDirty();
+
+            if (std::abs(std::abs(a.currentAngle) - std::abs(a.targetAngle)) < 1e-3f ||
+                remaining <= 1e-4f) {
+                // finish; the others turn disjoint layers about the same axis, so landing
+                // this one doesn't disturb them
+                LayerTurn turn = a.turn;
+                m_anims[i] = m_anims[--m_animCount];
+                landTurn(turn);
+                landed = true;
+            } else {
+                ++i;
+            }
         }
+        if (landed) startNextInQueue();
     } else {
         // if idle and queue non-empty start next
         if (!m_queue.empty()) {
@@ -129,172 +279,742 @@ void Core::update(float deltaSeconds)
     }
 }
 
+double Core::clockSeconds() const
+{
+    return m_clock;
+}
+
+uint64_t Core::landedTurnCount() const
+{
+    return m_landedTurns;
+}
+
+void Core::setMoveRecorder(MoveLogWriter* recorder)
+{
+    m_recorder = recorder;
+}
+
 bool Core::queueMove(const std::string& move)
 {
-    char face; int amount; bool prime;
-    if (!parseMove(move, face, amount, prime)) return false;
-    m_queue.push_back(move);
+    LayerTurn t;
+    if (!parseLayerTurn(move.data(), move.size(), m_size, t)) return false;
+    return queueMove(t);
+}
+
+bool Core::queueMove(Move move)
+{
+    return queueMove(layerTurnFromMove(move, m_size));
+}
+
+bool Core::queueMove(const LayerTurn& turn)
+{
+    if (!isValidLayerTurn(turn, m_size)) return false;
+    if (m_simplifyQueue && mergeIntoQueue(turn)) return true;
+    if (m_queue.full()) {
+        if (m_overflow == QueueOverflow::Reject || m_queue.capacity() == 0) return false;
+        // make room without losing input: the running turn and the oldest queued one land instantly
+        LayerTurn oldest = m_queue.pop();
+        applySequence(&oldest, 1);
+    }
+    m_queue.push(turn);
     return true;
 }
 
+bool Core::mergeIntoQueue(const LayerTurn& turn)
+{
+    // the queued turns after the last one about another axis all commute with `turn`
+    // (same rule as simplifyLayerTurns; the running animation is left alone)
+    for (size_t k = m_queue.size(); k > 0 && m_queue.at(k - 1).axis == turn.axis; --k) {
+        if (!mergeLayerTurn(m_queue.at(k - 1), turn)) continue;
+        if (m_queue.at(k - 1).quarterTurns == 0) {
+            for (size_t j = k; j < m_queue.size(); ++j) m_queue.at(j - 1) = m_queue.at(j);
+            m_queue.popBack();
+        }
+        return true;
+    }
+    return false;
+}
+
 bool Core::startMoveImmediate(const std::string& move)
+{
+    LayerTurn t;
+    if (!parseLayerTurn(move.data(), move.size(), m_size, t)) {
+        m_queue.clear();
+        return false;
+    }
+    return startMoveImmediate(t);
+}
+
+void Core::startMoveImmediate(Move move)
+{
+    startMoveImmediate(layerTurnFromMove(move, m_size));
+}
+
+bool Core::startMoveImmediate(const LayerTurn& turn)
 {
     m_queue.clear();
-    char face; int amount; bool prime;
-    if (!parseMove(move, face, amount, prime)) return false;
-    startParsedMove(face, amount, prime);
+    if (!isValidLayerTurn(turn, m_size)) return false;
+    startMove(turn);
     return true;
 }
 
 void Core::startNextInQueue()
 {
-    if (m_anim.active) return;
-    if (m_queue.empty()) return;
-    std::string mv = m_queue.front();
-    m_queue.erase(m_queue.begin());
-    char face; int amount; bool prime;
-    if (!parseMove(mv, face, amount, prime)) return;
-    startParsedMove(face, amount, prime);
+    // only ever the front of the queue, so turns still start in queue order
+    while (!m_queue.empty() && canStartAlongside(m_queue.front())) beginAnimation(m_queue.pop());
+}
+
+bool Core::canStartAlongside(const LayerTurn& turn) const
+{
+    if (m_animCount == 0) return true;
+    if (!m_concurrentTurns || m_animCount == kMaxActiveTurns) return false;
+    // turns about one axis commute, and disjoint layers keep every sticker in one animation
+    for (int i = 0; i < m_animCount; ++i) {
+        const LayerTurn &a = m_anims[i].turn;
+        if (a.axis != turn.axis || (turn.last >= a.first && turn.first <= a.last)) return false;
+    }
+    return true;
 }
 
 bool Core::isAnimating() const {
-    return m_anim.active;
+    return m_animCount > 0;
+}
+
+bool Core::isIdle() const
+{
+    return m_animCount == 0 && m_queue.empty() && m_submissions->empty();
 }
 
 void Core::clearQueue() {
     m_queue.clear();
 }
 
-bool Core::parseMove(const std::string& move, char& face, int& amount, bool& prime)
+bool Core::submitMove(Move move)
+{
+    return pushSubmission(layerTurnFromMove(move, m_size));
+}
+
+bool Core::submitMove(const LayerTurn& turn)
+{
+    // checked here, on the producer's thread: update() trusts what it drains
+    if (!isValidLayerTurn(turn, m_size)) return false;
+    return pushSubmission(turn);
+}
+
+bool Core::submitMove(const std::string& move)
+{
+    // parsing is pure, so it happens on the producer's thread
+    LayerTurn t;
+    if (!parseLayerTurn(move.data(), move.size(), m_size, t)) return false;
+    return pushSubmission(t);
+}
+
+// In-band marker in the submission stream; never a valid turn (there are only 3 axes).
+static LayerTurn clearQueueMarker()
+{
+    LayerTurn t;
+    t.axis = 0xFF;
+    return t;
+}
+
+bool Core::submitClearQueue()
+{
+    return pushSubmission(clearQueueMarker());
+}
+
+bool Core::pushSubmission(const LayerTurn& turn)
 {
-    // expected forms: "U", "U'", "U2", optionally with whitespace trimmed
-    if (move.empty()) return false;
-    std::string s;
-    for (char c : move) if (!isspace((unsigned char)c)) s.push_back(c);
-    face = toupper(s[0]);
-    if (strchr("UDLRFB", face) == nullptr) return false;
-    amount = 1;
-    prime = false;
-    if (s.size() >= 2) {
-        if (s[1] == '2') amount = 2;
-        else if (s[1] == '\'' ) prime = true;
+    if (!m_submissions->tryPush(turn)) return false;
+    if (m_submitWake) m_submitWake(m_submitWakeContext);
+    return true;
+}
+
+void Core::setSubmitWakeup(void (*wake)(void* context), void* context)
+{
+    m_submitWake = wake;
+    m_submitWakeContext = context;
+}
+
+bool Core::hasPendingSubmissions() const
+{
+    return !m_submissions->empty();
+}
+
+size_t Core::submissionCapacity() const
+{
+    return m_submissions->capacity();
+}
+
+void Core::drainSubmissions()
+{
+    LayerTurn t;
+    while (m_submissions->tryPop(t)) {
+        if (t.axis > 2) m_queue.clear();
+        else queueMove(t);
     }
-    if (s.size() >= 3) {
-        // e.g. "R2'" - support it (amount then prime)
-        if (s[1] == '2' && s[2] == '\'') prime = true;
+}
+
+void Core::setQueueOverflow(QueueOverflow policy)
+{
+    m_overflow = policy;
+}
+
+void Core::setQueueSimplification(bool enabled)
+{
+    m_simplifyQueue = enabled;
+}
+
+void Core::setBacklogPolicy(const BacklogPolicy& policy)
+{
+    m_backlog = policy;
+    m_backlog.maxLatency = std::max(m_backlog.maxLatency, 1e-3f);
+    m_backlog.maxSpeedScale = std::max(m_backlog.maxSpeedScale, 1.0f);
+    if (!m_backlog.enabled) m_speedScale = 1.0f;
+}
+
+float Core::animationSpeedScale() const
+{
+    return m_speedScale;
+}
+
+void Core::catchUpBacklog()
+{
+    if (!m_backlog.enabled) return;
+
+    // time to show everything at normal speed, counting each turn as a quarter turn and the
+    // running animations as one more
+    float turnSeconds = 90.0f / std::max(m_animSpeedDeg, 1e-3f);
+    size_t pending = m_queue.size() + (m_animCount > 0 ? 1 : 0);
+    float needed = pending * turnSeconds / m_backlog.maxLatency;
+
+    if (needed > m_backlog.maxSpeedScale && m_queue.size() > m_backlog.keepAnimated) {
+        // too far behind to animate: land the oldest turns in one headless batch
+        m_parseBuffer.clear();
+        while (m_queue.size() > m_backlog.keepAnimated) m_parseBuffer.push_back(m_queue.pop());
+        applySequence(m_parseBuffer.data(), m_parseBuffer.size());
+        pending = m_queue.size();
+        needed = pending * turnSeconds / m_backlog.maxLatency;
     }
-    return true;
+    m_speedScale = std::min(std::max(needed, 1.0f), m_backlog.maxSpeedScale);
+}
+
+void Core::setQueueCapacity(size_t capacity)
+{
+    m_queue.reset(capacity);
 }
 
-void Core::startParsedMove(char face, int amount, bool prime)
+size_t Core::queueCapacity() const
 {
-    // map face to axis & layer
+    return m_queue.capacity();
+}
+
+size_t Core::queuedMoveCount() const
+{
+    return m_queue.size();
+}
+
+void Core::startMove(const LayerTurn& turn)
+{
+    // an interrupted animation leaves its layers drawn mid-turn; snap them back to rest
+    // (the interrupted turns are dropped, as before)
+    if (m_animCount > 0) {
+        ensureStickerView();
+        for (int i = 0; i < m_animCount; ++i) {
+            const LayerTurn &t = m_anims[i].turn;
+            if (m_modelMatrices.empty()) break;
+            for (int layer = t.first; layer <= t.last; ++layer)
+                for (int idx : m_layerMembers[t.axis][layer]) writeBaseModel(idx, m_modelMatrices[idx]);
+        }
+        m_animCount = 0;
+        markTransformsDirty();
+    }
+    beginAnimation(turn);
+}
+
+void Core::beginAnimation(const LayerTurn& turn)
+{
+    // map axis index to rotation axis
     glm::vec3 axis(0.0f);
-    int layer = 0;
-    if (face == 'U') { axis = glm::vec3(0,1,0); layer = +1; }
-    if (face == 'D') { axis = glm::vec3(0,1,0); layer = -1; }
-    if (face == 'F') { axis = glm::vec3(0,0,1); layer = +1; }
-    if (face == 'B') { axis = glm::vec3(0,0,1); layer = -1; }
-    if (face == 'R') { axis = glm::vec3(1,0,0); layer = +1; }
-    if (face == 'L') { axis = glm::vec3(1,0,0); layer = -1; }
-
-    // determine total angle
-    float angle = 90.0f * amount;
-    if (prime) angle = -angle;
-    // special-case: double-turn direction irrelevant sign, keep positive 180
-    if (amount == 2) angle = 180.0f * (prime ? 1.0f : 1.0f);
+    axis[turn.axis] = 1.0f;
+
+    // determine total angle: quarterTurns are counter-clockwise about +axis (see LayerTurn);
+    // 3 quarter turns animate as one -90 turn
+    float angle = 90.0f * turn.quarterTurns;
+    if (turn.quarterTurns == 3) angle = -90.0f;
+
+    // the animation path works on stickers, so catch up with any headless moves first
+    ensureStickerView();
 
     // start animation
-    m_anim.active = true;
-    m_anim.axis = axis;
-    m_anim.layer = layer;
-    m_anim.targetAngle = angle;
-    m_anim.currentAngle = 0.0f;
-    // speed already set in m_anim.speedDeg
+    Anim &a = m_anims[m_animCount++];
+    a.turn = turn;
+    a.axis = axis;
+    a.targetAngle = angle;
+    a.currentAngle = 0.0f;
+}
+
+void Core::applyTurnDiscrete(const LayerTurn& turn)
+{
+    // Apply a discrete rotation to the stickers in the turned layers (update their logical
+    // position and face). Lattice vectors rotate exactly by swapping and negating
+    // components, so no trig or rounding is involved; faces follow from a table. Their
+    // stickerModelMatrices() entries (if that buffer exists) are rebuilt lazily by
+    // flushPendingBaseModels().
+    int ax = turn.axis;
+    int u = (ax + 1) % 3, v = (ax + 2) % 3; // (u, v) -> (-v, u) is +90 degrees about ax
+    int qt = turn.quarterTurns & 3;
+    const uint8_t *turnedFace = faceTurnTable().face[ax][qt];
+    bool trackPending = !m_modelMatrices.empty();
+
+    // The layers keep their coordinate along the axis, so their own member lists stay valid;
+    // only the memberships along the two perpendicular axes change.
+    // The state hash swaps each moved sticker's key at its old facelet for the one at its new.
+    uint64_t hash = m_hash;
+    for (int layer = turn.first; layer <= turn.last; ++layer) {
+        for (uint16_t idx : m_layerMembers[ax][layer]) {
+            PackedSticker &s = m_stickers[idx];
+            int pu = s.pos[u], pv = s.pos[v];
+            int oldU = layerOf(pu), oldV = layerOf(pv);
+            for (int k = 0; k < qt; ++k) {
+                int t = pu; pu = -pv; pv = t;
+            }
+            s.pos[u] = (int8_t)pu;
+            s.pos[v] = (int8_t)pv;
+            s.faceColor = (uint8_t)((s.faceColor & ~7) | turnedFace[stickerFace(s)]);
+            uint64_t key = m_zobrist[faceletIndex(s, m_size) * 6 + stickerColor(s)];
+            hash ^= m_stickerKey[idx] ^ key;
+            m_stickerKey[idx] = key;
+            moveLayerMember(u, idx, oldU, layerOf(pu));
+            moveLayerMember(v, idx, oldV, layerOf(pv));
+
+            if (trackPending && !m_basePending[idx]) {
+                m_basePending[idx] = 1;
+                m_pendingBase.push_back(idx);
+            }
+        }
+    }
+    m_hash = hash;
+    markRestChanged();
+}
+
+void Core::landTurn(const LayerTurn& turn)
+{
+    // keep the cubie mirror while it can represent the state; slice/wide turns end it
+    Move m;
+    if (m_cubieValid && !layerTurnToMove(turn, m_size, m)) leaveCubieState();
+    if (m_cubieValid) m_cubie.applyMove(m);
+    applyTurnDiscrete(turn);
+    ++m_landedTurns;
+    if (m_recorder) m_recorder->appendTurn(turn, m_clock, *this);
 }
 
-void Core::applyRotationDiscrete(const glm::vec3& axis, int layer, float angleDeg)
+std::vector<glm::mat4> Core::getStickerModelMatrices()
 {
-    // Apply discrete rotation to stickers in the layer (update their logical cubePos and normal),
-    // then rebuild baseModel for all stickers to reflect new resting positions.
-    // We'll rotate integer positions using quaternion and rounding.
+    return stickerModelMatrices();
+}
 
-    glm::vec3 a = glm::normalize(axis);
-    float rad = glm::radians(angleDeg);
-    glm::quat q = glm::angleAxis(rad, a);
+std::vector<glm::vec3> Core::getStickerColors()
+{
+    return stickerColors();
+}
 
-    for (auto &s : m_stickers) {
-        // Determine sticker's integer coordinate along axis to see if it's part of the rotating layer.
-        // axis is axis vector of one component 1; layer in -1..1.
-        int coord = 0;
-        if (std::abs(axis.x) > 0.5f) coord = s.cubePos.x;
-        else if (std::abs(axis.y) > 0.5f) coord = s.cubePos.y;
-        else coord = s.cubePos.z;
+size_t Core::stickerCount() const
+{
+    return m_stickers.size();
+}
 
-        if (coord != layer) continue;
+const std::vector<glm::mat4>& Core::stickerModelMatrices()
+{
+    refreshModelMatrices();
+    return m_modelMatrices;
+}
 
-        // rotate cubePos (integer vector) by quaternion and round to nearest integer
-        glm::vec3 p = glm::vec3(s.cubePos);
-        glm::vec3 p2 = glm::round(glm::vec3(q * p));
-        s.cubePos = glm::ivec3((int)p2.x, (int)p2.y, (int)p2.z);
+const std::vector<glm::vec3>& Core::stickerColors() const
+{
+    if (m_colors.empty()) {
+        m_colors.resize(m_stickers.size());
+        for (size_t i = 0; i < m_stickers.size(); ++i) m_colors[i] = PALETTE[stickerColor(m_stickers[i])];
+    }
+    return m_colors;
+}
 
-        // rotate normal
-        glm::vec3 n = glm::vec3(s.normal);
-        glm::vec3 n2 = glm::round(glm::vec3(q * n));
-        s.normal = glm::ivec3((int)n2.x, (int)n2.y, (int)n2.z);
+size_t Core::writeStickerTransforms(StickerTransform* out, size_t count)
+{
+    // built straight from the packed stickers: every sticker at rest first, then
+    // final = layerModel * baseModel for the turning layers, with the layer part built once
+    // per animation
+    size_t n = writeStickerRestTransforms(out, count);
+    for (int i = 0; i < m_animCount; ++i) {
+        const Anim &a = m_anims[i];
+        glm::mat4 layerModel = layerModelMatrix(a);
+        for (int layer = a.turn.first; layer <= a.turn.last; ++layer) {
+            for (uint16_t idx : m_layerMembers[a.turn.axis][layer]) {
+                if (idx < n) out[idx].model = layerModel * out[idx].model;
+            }
+        }
     }
+    return n;
+}
+
+size_t Core::writePackedStickers(PackedSticker* out, size_t count)
+{
+    ensureStickerView();
+    size_t n = std::min(count, m_stickers.size());
+    std::copy(m_stickers.begin(), m_stickers.begin() + n, out);
+    return n;
+}
+
+const StickerGeometry& Core::stickerGeometry() const
+{
+    return m_geometry;
+}
+
+const glm::vec3* Core::colorPalette()
+{
+    return PALETTE;
+}
+
+uint8_t Core::stickerColorId(size_t index) const
+{
+    return (uint8_t)stickerColor(m_stickers[index]);
+}
+
+bool Core::hasCubieState() const
+{
+    return m_cubieValid;
+}
+
+const CubieCube& Core::cubieState() const
+{
+    return m_cubie;
+}
 
-    // rebuild base models for all stickers (positions changed)
-    for (auto &s : m_stickers) {
-        rebuildBaseModel(s);
+uint64_t Core::stateHash() const
+{
+    // 20 lookups on the cubie model rather than tracking it through every 3x3 move
+    return m_cubieValid ? m_cubie.hash() : m_hash;
+}
+
+void Core::leaveCubieState()
+{
+    if (!m_cubieValid) return;
+    // the sticker path tracks the hash from here on; re-key the stickers from their facelets
+    m_cubieValid = false;
+    m_hash = 0;
+    for (size_t i = 0; i < m_stickers.size(); ++i) {
+        m_stickerKey[i] = m_zobrist[faceletIndex(m_stickers[i], m_size) * 6 + stickerColor(m_stickers[i])];
+        m_hash ^= m_stickerKey[i];
     }
 }
 
-std::vector<glm::mat4> Core::getStickerModelMatrices()
+bool Core::setCubieState(const CubieCube& state)
+{
+    if (m_size != 3 || !state.isValid()) return false;
+
+    m_queue.clear();
+    m_animCount = 0;
+    m_cubie = state;
+    m_cubieValid = true;
+    m_stickersStale = true;
+    markRestChanged();
+    if (m_recorder) m_recorder->appendStateJump(m_clock, *this);
+    return true;
+}
+
+void Core::writeFaceletColors(uint8_t* out) const
+{
+    if (m_cubieValid) {
+        // facelet i shows sticker src[i], whose color is its home face
+        uint8_t src[54];
+        m_cubie.toFaceletPermutation(src);
+        for (int i = 0; i < 54; ++i) out[i] = src[i] / 9;
+        return;
+    }
+    for (size_t i = 0; i < m_stickers.size(); ++i)
+        out[faceletIndex(m_stickers[i], m_size)] = (uint8_t)stickerColor(m_stickers[i]);
+}
+
+bool Core::setFaceletColors(const uint8_t* colors)
+{
+    size_t cells = (size_t)m_size * m_size;
+    size_t perColor[6] = {};
+    for (size_t i = 0; i < 6 * cells; ++i) {
+        if (colors[i] > 5 || ++perColor[colors[i]] > cells) return false;
+    }
+
+    CubieCube state;
+    if (m_size == 3 && CubieCube::fromFacelets(colors, state) && state.isValid()) return setCubieState(state);
+
+    // Sticker path: facelet i gets the next unused sticker of its color. Stickers of one
+    // color are interchangeable in the logical state (colors are all the hash sees).
+    m_queue.clear();
+    m_animCount = 0;
+    m_cubieValid = false;
+    m_stickersStale = false;
+    size_t next[6] = {};
+    for (size_t i = 0; i < 6 * cells; ++i) {
+        size_t idx = colors[i] * cells + next[colors[i]]++;
+        homeFacelet((int)i, m_size, m_stickers[idx]);
+    }
+    for (int ax = 0; ax < 3; ++ax) rebuildLayerIndex(ax);
+    m_hash = 0;
+    for (size_t i = 0; i < m_stickers.size(); ++i) {
+        m_stickerKey[i] = m_zobrist[faceletIndex(m_stickers[i], m_size) * 6 + stickerColor(m_stickers[i])];
+        m_hash ^= m_stickerKey[i];
+    }
+    if (!m_modelMatrices.empty()) {
+        for (uint16_t idx : m_pendingBase) m_basePending[idx] = 0;
+        m_pendingBase.clear();
+        for (size_t i = 0; i < m_stickers.size(); ++i) writeBaseModel(i, m_modelMatrices[i]);
+    }
+    markRestChanged();
+    if (m_recorder) m_recorder->appendStateJump(m_clock, *this);
+    return true;
+}
+
+void Core::writeStickerFacelets(uint16_t* out) const
+{
+    if (m_cubieValid) {
+        uint8_t src[54];
+        m_cubie.toFaceletPermutation(src);
+        for (int i = 0; i < 54; ++i) out[src[i]] = (uint16_t)i;
+        return;
+    }
+    for (size_t i = 0; i < m_stickers.size(); ++i) out[i] = (uint16_t)faceletIndex(m_stickers[i], m_size);
+}
+
+bool Core::applyCompiled(const CompiledSequence& seq)
+{
+    if (seq.size() != m_size) return false;
+    finishAnimationInstantly();
+    if (m_cubieValid && seq.hasCubie()) {
+        seq.applyTo(m_cubie);
+        m_stickersStale = true;
+    } else {
+        syncStickersFromCubie();
+        leaveCubieState();
+        // every sticker moves to its new facelet; the layer lists are rebuilt rather than patched
+        uint64_t hash = m_hash;
+        for (size_t i = 0; i < m_stickers.size(); ++i) {
+            PackedSticker &s = m_stickers[i];
+            homeFacelet(seq.to(faceletIndex(s, m_size)), m_size, s);
+            uint64_t key = m_zobrist[faceletIndex(s, m_size) * 6 + stickerColor(s)];
+            hash ^= m_stickerKey[i] ^ key;
+            m_stickerKey[i] = key;
+        }
+        m_hash = hash;
+        for (int ax = 0; ax < 3; ++ax) rebuildLayerIndex(ax);
+        if (!m_modelMatrices.empty()) {
+            for (uint16_t idx : m_pendingBase) m_basePending[idx] = 0;
+            m_pendingBase.clear();
+            for (size_t i = 0; i < m_stickers.size(); ++i) writeBaseModel(i, m_modelMatrices[i]);
+        }
+    }
+    markRestChanged();
+    if (m_recorder) m_recorder->appendStateJump(m_clock, *this);
+    return true;
+}
+
+void Core::applySequence(const Move* moves, size_t count)
 {
-    std::vector<glm::mat4> mats;
-    mats.reserve(m_stickers.size());
-
-    // if animating, compute an extra rotation around the proper axis & center
-    bool anim = m_anim.active;
-    glm::quat q_anim = glm::quat(1,0,0,0);
-    glm::vec3 axisCenter(0.0f);
-    if (anim) {
-        float curAngle = m_anim.currentAngle;
-        float rad = glm::radians(curAngle);
-        glm::vec3 a = glm::normalize(m_anim.axis);
-        q_anim = glm::angleAxis(rad, a);
-        axisCenter = glm::vec3(m_anim.axis) * (float)m_anim.layer * m_spacing;
-    }
-
-    for (const auto &s : m_stickers) {
-        if (!anim) {
-            mats.push_back(s.baseModel);
-            continue;
+    if (count == 0) return;
+    // land first: a slice turn still animating ends the cubie model when it lands
+    finishAnimationInstantly();
+    if (!m_cubieValid) {
+        for (size_t i = 0; i < count; ++i) {
+            LayerTurn t = layerTurnFromMove(moves[i], m_size);
+            applySequence(&t, 1);
+        }
+        return;
+    }
+    if (m_recorder) {
+        // one at a time, so the recorder sees (and can checkpoint) every state in between
+        for (size_t i = 0; i < count; ++i) {
+            m_cubie.applyMove(moves[i]);
+            m_recorder->appendTurn(layerTurnFromMove(moves[i], m_size), m_clock, *this);
         }
-        // determine if this sticker's cubePos belongs to rotating layer
-        int coord = 0;
-        if (std::abs(m_anim.axis.x) > 0.5f) coord = s.cubePos.x;
-        else if (std::abs(m_anim.axis.y) > 0.5f) coord = s.cubePos.y;
-        else coord = s.cubePos.z;
-
-        if (coord != m_anim.layer) {
-            mats.push_back(s.baseModel);
+    } else {
+        m_cubie.applySequence(moves, count);
+    }
+    m_landedTurns += count;
+    m_stickersStale = true;
+    markRestChanged();
+}
+
+bool Core::applySequence(const LayerTurn* turns, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (!isValidLayerTurn(turns[i], m_size)) return false;
+    }
+    if (count == 0) return true;
+    finishAnimationInstantly();
+    for (size_t i = 0; i < count; ++i) {
+        Move m;
+        if (m_cubieValid && layerTurnToMove(turns[i], m_size, m)) {
+            m_cubie.applyMove(m);
+            m_stickersStale = true;
         } else {
-            // final = T(center) * R * T(-center) * baseModel
-            glm::mat4 T1 = glm::translate(glm::mat4(1.0f), axisCenter);
-            glm::mat4 R = glm::toMat4(q_anim);
-            glm::mat4 T2 = glm::translate(glm::mat4(1.0f), -axisCenter);
-            mats.push_back(T1 * R * T2 * s.baseModel);
+            syncStickersFromCubie();
+            leaveCubieState();
+            applyTurnDiscrete(turns[i]);
         }
+        if (m_recorder) m_recorder->appendTurn(turns[i], m_clock, *this);
     }
-    return mats;
+    m_landedTurns += count;
+    markRestChanged();
+    return true;
 }
 
-std::vector<glm::vec3> Core::getStickerColors()
+bool Core::applySequence(const std::string& moves)
+{
+    m_parseBuffer.clear(); // keeps capacity
+    if (!parseLayerTurnSequence(moves, m_size, m_parseBuffer)) return false;
+    applySequence(m_parseBuffer.data(), m_parseBuffer.size());
+    return true;
+}
+
+void Core::finishAnimationInstantly()
+{
+    while (m_animCount > 0) landTurn(m_anims[--m_animCount].turn);
+}
+
+void Core::syncStickersFromCubie()
+{
+    if (!m_stickersStale) return;
+    m_stickersStale = false;
+
+    // derive the sticker view (3x3 only): facelet i now shows sticker src[i]
+    uint8_t src[54];
+    m_cubie.toFaceletPermutation(src);
+    for (int i = 0; i < 54; ++i) homeFacelet(i, m_size, m_stickers[src[i]]);
+    if (!m_modelMatrices.empty())
+        for (int i = 0; i < 54; ++i) writeBaseModel(i, m_modelMatrices[i]);
+    for (int ax = 0; ax < 3; ++ax) rebuildLayerIndex(ax);
+}
+
+void Core::flushPendingBaseModels()
+{
+    for (uint16_t idx : m_pendingBase) {
+        m_basePending[idx] = 0;
+        writeBaseModel(idx, m_modelMatrices[idx]);
+    }
+    m_pendingBase.clear();
+}
+
+void Core::ensureStickerView()
+{
+    syncStickersFromCubie();
+    flushPendingBaseModels();
+}
+
+uint64_t Core::generation() const
+{
+    return m_generation;
+}
+
+bool Core::transformsDirty() const
+{
+    return m_matricesDirty;
+}
+
+void Core::markTransformsDirty()
 {
-    std::vector<glm::vec3> cols;
-    cols.reserve(m_stickers.size());
-    for (const auto &s : m_stickers) cols.push_back(s.color);
-    return cols;
-}
\ No newline at end of file
+    m_matricesDirty = true;
+    ++m_generation;
+}
+
+void Core::markRestChanged()
+{
+    ++m_restGeneration;
+    markTransformsDirty();
+}
+
+uint64_t Core::restGeneration() const
+{
+    return m_restGeneration;
+}
+
+size_t Core::writeStickerRestTransforms(StickerTransform* out, size_t count)
+{
+    ensureStickerView();
+    size_t n = std::min(count, m_stickers.size());
+    for (size_t i = 0; i < n; ++i) {
+        writeBaseModel(i, out[i].model);
+        out[i].color = PALETTE[stickerColor(m_stickers[i])];
+    }
+    return n;
+}
+
+size_t Core::writeStickerCubePositions(glm::vec3* out, size_t count)
+{
+    ensureStickerView();
+    size_t n = std::min(count, m_stickers.size());
+    for (size_t i = 0; i < n; ++i) {
+        const int8_t *p = m_stickers[i].pos;
+        out[i] = glm::vec3((float)layerOf(p[0]), (float)layerOf(p[1]), (float)layerOf(p[2]));
+    }
+    return n;
+}
+
+glm::mat4 Core::layerModelMatrix(const Anim& anim) const
+{
+    // every layer's pivot lies on the axis through the cube's centre, so the layer
+    // transform is a plain rotation
+    float rad = glm::radians(anim.currentAngle);
+    glm::quat q_anim = glm::angleAxis(rad, anim.axis);
+    return glm::toMat4(q_anim);
+}
+
+int Core::layerAnimationCount() const
+{
+    return m_animCount;
+}
+
+Core::LayerAnimation Core::layerAnimation(int index) const
+{
+    LayerAnimation la;
+    if (index < 0 || index >= m_animCount) return la;
+    const Anim &a = m_anims[index];
+    la.active = true;
+    la.axis = a.axis;
+    la.layerFirst = a.turn.first;
+    la.layerLast = a.turn.last;
+    la.layerModel = layerModelMatrix(a);
+    return la;
+}
+
+void Core::setConcurrentTurns(bool enabled)
+{
+    m_concurrentTurns = enabled;
+}
+
+void Core::refreshModelMatrices()
+{
+    ensureStickerView();
+
+    // first use: start the buffer from the resting transforms
+    if (m_modelMatrices.empty()) {
+        m_modelMatrices.resize(m_stickers.size());
+        m_basePending.assign(m_stickers.size(), 0);
+        for (size_t i = 0; i < m_stickers.size(); ++i) writeBaseModel(i, m_modelMatrices[i]);
+        m_matricesDirty = true;
+    }
+
+    // idle frames: nothing moved since the last refresh, the buffer is still valid
+    if (!m_matricesDirty) return;
+    m_matricesDirty = false;
+
+    // Resting stickers already hold their baseModel (written when a move finishes),
+    // so only the rotating layers need new matrices.
+    // final = layerModel * baseModel, with the layer part built once per animation per frame
+    for (int i = 0; i < m_animCount; ++i) {
+        const Anim &a = m_anims[i];
+        glm::mat4 layerModel = layerModelMatrix(a);
+        for (int layer = a.turn.first; layer <= a.turn.last; ++layer) {
+            for (int idx : m_layerMembers[a.turn.axis][layer]) {
+                writeBaseModel(idx, m_modelMatrices[idx]);
+                m_modelMatrices[idx] = layerModel * m_modelMatrices[idx];
+            }
+        }
+    }
+}
@@ -2,94 +2,358 @@
 #define CORE_H
 
 // Core - Rubik's cube simulation + animation helper
-// - Keeps logical sticker state (54 stickers)
-// - Supports queued moves like "R", "U'", "F2"
+// - Keeps logical sticker state for an NxN cube (N = 2..33, 6*N*N stickers; default 3)
+// - Supports queued moves like "R", "U'", "F2" (standard notation: clockwise looking at the face)
+//   plus slice and wide turns ("2R", "Rw", "3Uw'", "M", and "r" from 4x4 up) - see parseLayerTurn() in move.h
+// - Stickers are stored as 4-byte PackedStickers (lattice position, facing, color id) with a
+//   per-layer index, so a turn only visits the stickers of the layers it moves; transforms are
+//   derived from them when exported, and colors come from a 6-entry palette
+// - On 3x3 cubes, mirrors the logical state in a compact CubieCube (see cubie.h)
 // - Produces per-sticker model matrices and colors so your renderer (OpenGL+GLFW+GLAD)
 //   can draw each sticker (or each cubie face) using your existing draw code.
 // Usage:
-//   Core core;
+//   Core core;                           // or Core core(1.0f, 0.03f, 360.0f, 7) for a 7x7
 //   // each frame:
 //   core.update(deltaSeconds);
-//   auto mats = core.getStickerModelMatrices(); // 54 matrices
-//   auto cols = core.getStickerColors();       // 54 colors
-//   // feed mats/cols to your draw path
+//   const auto& mats = core.stickerModelMatrices(); // stickerCount() matrices, no allocation
+//   const auto& cols = core.stickerColors();        // stickerCount() colors
+//   // feed mats/cols to your draw path, or write straight into your own buffer:
+//   core.writeStickerTransforms(buf, core.stickerCount());
+//   // or upload 4 bytes per sticker and build the transforms in the vertex shader:
+//   core.writePackedStickers(packed, core.stickerCount()); // + stickerGeometry(), colorPalette()
 //
 // Requires GLM (vec/mat/quaternion). No GLFW/glad calls here.
 
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "cubie.h"
+#include "move.h"
+#include "ring_buffer.h"
+#include "mpsc_queue.h"
+
+class CompiledSequence;
+class MoveLogWriter;
 
 struct StickerTransform {
     glm::mat4 model;
     glm::vec3 color;
 };
 
+// One sticker in 4 bytes: its lattice position, doubled and centred (each component is
+// 2 * layer - (size - 1)), plus faceColor = face it points at (bits 0-2) | color id << 3, both
+// 0..5 in U R F D L B order (the color id is the sticker's home face). This is Core's own
+// storage format, so writePackedStickers() is a plain copy.
+struct PackedSticker {
+    int8_t pos[3];
+    uint8_t faceColor;
+};
+
+// Rebuilds a resting sticker transform from a PackedSticker with face f:
+//   model = translate(pos * halfSpacing + normal[f] * surfaceOffset) * orientation[f]
+struct StickerGeometry {
+    glm::mat4 orientation[6]; // rotation * scale of the sticker quad facing each face
+    glm::vec3 normal[6];      // outward unit normal of each face
+    float halfSpacing = 0.0f;
+    float surfaceOffset = 0.0f;
+};
+
 class Core {
 public:
     // cubieSize: length of each small cube (default 1.0)
     // gap: spacing between cubelets (small gap to see seams)
     // animSpeedDegPerSec: rotation speed in degrees/sec (default 360 => 90deg in 0.25s)
-    Core(float cubieSize = 1.0f, float gap = 0.03f, float animSpeedDegPerSec = 360.0f);
+    // size: cubies per edge, clamped to kMinSize..kMaxSize
+    Core(float cubieSize = 1.0f, float gap = 0.03f, float animSpeedDegPerSec = 360.0f, int size = 3);
+
+    static constexpr int kMinSize = 2;
+    static constexpr int kMaxSize = 33;
+    int size() const;
 
     // Call every frame with seconds elapsed since last frame
     void update(float deltaSeconds);
+    // Simulation time: the sum of every update() step so far.
+    double clockSeconds() const;
+    // Turns landed so far, animated or through applySequence() (not state jumps such as
+    // setCubieState()); the difference over a time span gives moves per second.
+    uint64_t landedTurnCount() const;
 
-    // Queue a move: "U", "U'", "U2", "R", "R'", "F2", etc.
-    // Accepts moves for: U D L R F B
-    // Returns true if accepted
+    // Queue a move: "U", "U'", "U2", "R", "R'", "F2", "2R", "Rw'", "M2", etc.
+    // Accepts outer turns for U D L R F B plus the slice/wide forms that fit size().
+    // Moves are parsed once into a 4-byte LayerTurn and kept in a fixed-capacity ring buffer.
+    // Returns true if accepted (false on a bad token or a LayerTurn that doesn't fit size()
+    // (isValidLayerTurn), or when full under QueueOverflow::Reject)
     bool queueMove(const std::string& move);
+    bool queueMove(Move move);
+    bool queueMove(const LayerTurn& turn);
 
-    // Start a move immediately (clears current animation queue and starts this)
+    // Start a move immediately (clears current animation queue and starts this). Returns false
+    // (queue cleared, nothing started) on a bad token or a LayerTurn that doesn't fit size().
     bool startMoveImmediate(const std::string& move);
+    void startMoveImmediate(Move move);
+    bool startMoveImmediate(const LayerTurn& turn);
+
+    // What queueMove does when the queue is full:
+    // - Reject: refuse the new move (queueMove returns false)
+    // - ApplyOldest: complete the running animation and the oldest queued move instantly
+    //   (headless path) to make room, so no input is lost and the final state stays correct
+    enum class QueueOverflow { Reject, ApplyOldest };
+    void setQueueOverflow(QueueOverflow policy);
+    // When enabled, queueMove folds each turn into the queued turns it commutes with (see
+    // simplifyLayerTurns() in move.h): "R R R" animates one R', "R L R" animates R2 then L,
+    // and "R R'" animates nothing. Only moves still waiting in the queue are merged. Default off.
+    void setQueueSimplification(bool enabled);
+    // What update() does when moves arrive faster than they animate (fast feeds, pasted
+    // algorithms): it bounds how far the display lags behind the input instead of the speed.
+    // - the animation speeds up so everything queued would finish within maxLatency seconds,
+    //   up to maxSpeedScale times the normal speed
+    // - when even that is too slow, all but the newest keepAnimated queued moves land at once
+    //   through the headless path (applySequence), so only those few still animate
+    // Speed returns to normal as the backlog drains. Disabled by default.
+    struct BacklogPolicy {
+        bool enabled = false;
+        float maxLatency = 1.0f;
+        float maxSpeedScale = 4.0f;
+        size_t keepAnimated = 4;
+    };
+    void setBacklogPolicy(const BacklogPolicy& policy);
+    // current animation speed multiplier chosen by the backlog policy (1 when idle or disabled)
+    float animationSpeedScale() const;
+
+    // Resize the queue (rounded up to a power of two); drops queued moves. Default 4096.
+    void setQueueCapacity(size_t capacity);
+    size_t queueCapacity() const;
+    size_t queuedMoveCount() const;
+
+    // Thread-safe move submission for producers other than the render thread (network,
+    // scripting, solver...). Lock-free: a producer never blocks and never contends with
+    // update(). Submissions are drained into the move queue once per update(), in arrival
+    // order, and then follow the queue's overflow policy. Returns false on a bad token, a
+    // LayerTurn that doesn't fit size(), or when the submission buffer (submissionCapacity(), default 4096) is full.
+    // submitClearQueue() is the thread-safe clearQueue(): it takes effect at that point in the
+    // submission stream, dropping everything queued before it.
+    // These are the only members that may be called concurrently with the rest of Core.
+    bool submitMove(Move move);
+    bool submitMove(const LayerTurn& turn);
+    bool submitMove(const std::string& move);
+    bool submitClearQueue();
+    bool hasPendingSubmissions() const;
+    size_t submissionCapacity() const;
+    // Called on the producer's thread after every accepted submission, e.g. to wake a render
+    // loop blocked in glfwWaitEvents() (glfwPostEmptyEvent). Set it before producers start.
+    void setSubmitWakeup(void (*wake)(void* context), void* context);
 
     // Are we currently animating a rotation?
     bool isAnimating() const;
+    // Nothing left to do until new input arrives: no turn running, nothing queued or submitted.
+    // update() then changes nothing but the clock, so a renderer may stop drawing.
+    bool isIdle() const;
+
+    // When enabled, queued turns about the same axis as the running ones and on disjoint layers
+    // start right away instead of waiting, so "U D" or "R L'" animate together (up to
+    // kMaxActiveTurns at once). Turns still start in queue order. Default off.
+    static constexpr int kMaxActiveTurns = 8;
+    void setConcurrentTurns(bool enabled);
 
-    // Get transforms & colors for all 54 stickers (in fixed order: U(9), R(9), F(9), D(9), L(9), B(9))
+    // Get transforms & colors for all stickers (in fixed order: U, R, F, D, L, B with N*N each,
+    // row-major as laid out in homeFacelet())
     // The order is stable but you can just iterate them together.
+    // These return fresh copies; prefer the allocation-free variants below in a frame loop.
     std::vector<glm::mat4> getStickerModelMatrices();
     std::vector<glm::vec3> getStickerColors();
 
+    // Allocation-free export (same order as above):
+    // - stickerModelMatrices()/stickerColors() refresh and return persistent internal buffers
+    //   (valid until the next non-const call)
+    // - writeStickerTransforms() fills a caller-owned array of up to `count` entries and
+    //   returns how many were written (min(count, stickerCount()))
+    size_t stickerCount() const;
+    const std::vector<glm::mat4>& stickerModelMatrices();
+    const std::vector<glm::vec3>& stickerColors() const;
+    size_t writeStickerTransforms(StickerTransform* out, size_t count);
+
+    // Compact export: the resting stickers as stored (4 bytes each, no per-sticker matrix or
+    // color). Draw them with the layerAnimation() data below, transforms rebuilt from
+    // stickerGeometry() and colors looked up in colorPalette() by id.
+    size_t writePackedStickers(PackedSticker* out, size_t count);
+    const StickerGeometry& stickerGeometry() const;
+    static const glm::vec3* colorPalette(); // 6 colors, by color id
+    uint8_t stickerColorId(size_t index) const;
+
+    // Bumped whenever any sticker transform changes (animation step or finished move).
+    // Compare against the value seen at your last upload to decide whether to re-upload.
+    // Colors belong to stickers and never change, so they only need uploading once.
+    uint64_t generation() const;
+
+    // GPU-side layer animation: resting transforms only change when a move lands (tracked by
+    // restGeneration()), and each turning layer range is described by layerAnimation(i) for
+    // i < layerAnimationCount() (at most one unless setConcurrentTurns(true); then all share an
+    // axis and their ranges don't overlap). A renderer can upload the rest transforms + lattice
+    // positions once per move and apply layerModel in the vertex shader to instances with
+    // layerFirst <= dot(cubePos, axis) <= layerLast.
+    struct LayerAnimation {
+        bool active = false;
+        glm::vec3 axis = glm::vec3(0.0f);       // unit rotation axis (+x, +y or +z)
+        int layerFirst = 0;                     // turning layers along axis, 0..size()-1
+        int layerLast = 0;
+        glm::mat4 layerModel = glm::mat4(1.0f); // R(currentAngle) about the cube's centre line
+    };
+    int layerAnimationCount() const;
+    LayerAnimation layerAnimation(int index = 0) const; // inactive if index is out of range
+    uint64_t restGeneration() const;
+    size_t writeStickerRestTransforms(StickerTransform* out, size_t count);
+    size_t writeStickerCubePositions(glm::vec3* out, size_t count); // layer indices, each in 0..size()-1
+
+    // True if sticker transforms changed since stickerModelMatrices() last refreshed its buffer.
+    // When false, stickerModelMatrices() skips recomputation.
+    bool transformsDirty() const;
+
     // Clear queued moves
     void clearQueue();
 
-private:
-    struct Sticker {
-        glm::ivec3 cubePos; // each component in {-1,0,1}
-        glm::ivec3 normal;  // one of axis unit vectors (e.g. (0,1,0))
-        glm::vec3 color;
-        glm::mat4 baseModel; // model transform when idle (no ongoing animation)
-    };
+    // Logical state as a compact cubie model, updated with one table lookup per finished move.
+    // Only tracked on 3x3 cubes turned with outer moves: hasCubieState() turns false after a
+    // slice/wide turn moves the centres, and stays false on other sizes.
+    bool hasCubieState() const;
+    const CubieCube& cubieState() const;
+    // Jump to a state: drops the queue and any running animation, then derives the sticker
+    // view from it (centres go back home). Returns false (nothing changed) if the state is
+    // not reachable or the cube isn't 3x3.
+    bool setCubieState(const CubieCube& state);
+
+    // Logical colors by facelet: 6 * size() * size() color ids (0..5, U R F D L B), facelet
+    // index face * N*N + row-major cell in sticker export order; a running animation counts
+    // once it lands.
+    void writeFaceletColors(uint8_t* out) const;
+    // Jump to the state showing `colors` (same layout): drops the queue and any running
+    // animation. Returns false (nothing changed) unless every color appears size() * size()
+    // times. On 3x3, states with the centres home go through setCubieState() when reachable.
+    bool setFaceletColors(const uint8_t* colors);
+    // out[i] = facelet (same layout) that sticker i rests on; sticker i starts on facelet i.
+    void writeStickerFacelets(uint16_t* out) const;
 
-    // current rotation animation state
+    // Apply a whole compiled sequence in one step, headless: any running animation lands first.
+    // While hasCubieState() and seq.hasCubie() it is one cubie multiply, otherwise one pass over
+    // the stickers. A recorder logs it as a state jump. False (nothing changed) if the size
+    // differs.
+    bool applyCompiled(const CompiledSequence& seq);
+
+    // Append every turn that lands in the logical state (animated or headless) to `recorder`,
+    // stamped with clockSeconds(), plus a checkpoint on every setCubieState()/
+    // setFaceletColors(). Pass nullptr to stop. Not owned; see move_log.h.
+    void setMoveRecorder(MoveLogWriter* recorder);
+
+    // 64-bit Zobrist hash of the logical colors (zobrist.h); a running animation counts once it
+    // lands. Sticker turns update it incrementally (O(stickers moved)); while hasCubieState()
+    // it is read off the cubie model (fixed cost). Equal states give equal hashes (on 3x3,
+    // equal to cubieState().hash()), so it can key a TranspositionTable or spot a repeated
+    // position without comparing stickers.
+    uint64_t stateHash() const;
+
+    // Headless batch application: moves are applied discretely to the logical state (no
+    // animation, no clock). The sticker view is only re-derived when a transform is requested
+    // or an animation starts, so long 3x3 sequences cost one table lookup per move; other
+    // turns update the affected layers' positions and defer their transforms the same way.
+    // A running animation is completed instantly first; queued moves stay queued.
+    // The string variant parses "R U R' U'" style text and returns false (applying nothing)
+    // on an invalid token; the LayerTurn variant likewise if any turn doesn't fit size().
+    void applySequence(const Move* moves, size_t count);
+    bool applySequence(const LayerTurn* turns, size_t count);
+    bool applySequence(const std::string& moves);
+
+private:
+    // one running rotation animation
     struct Anim {
-        bool active = false;
+        LayerTurn turn;          // layers being animated
         glm::vec3 axis = glm::vec3(0.0f);
-        int layer = 0;           // -1, 0, +1 for the layer coordinate along axis
         float targetAngle = 0.0f;// degrees (±90 or 180)
         float currentAngle = 0.0f;
-        float speedDeg = 360.0f; // deg per second
     };
 
 
     float m_cubieSize;
     float m_gap;
     float m_spacing; 
-    Anim m_anim;
-    std::vector<std::string> m_queue;
+    int m_size;
+    float m_animSpeedDeg;        // deg per second, shared by all animations
+    // running animations: one, or with m_concurrentTurns several about one axis on disjoint layers
+    Anim m_anims[kMaxActiveTurns];
+    int m_animCount = 0;
+    bool m_concurrentTurns = false;
+    BacklogPolicy m_backlog;
+    float m_speedScale = 1.0f;   // m_animSpeedDeg multiplier picked by catchUpBacklog()
+    CubieCube m_cubie;
+    RingBuffer<LayerTurn> m_queue;
+    std::unique_ptr<MpscQueue<LayerTurn>> m_submissions; // heap-held so Core stays movable
+    void (*m_submitWake)(void*) = nullptr;
+    void* m_submitWakeContext = nullptr;
+    QueueOverflow m_overflow = QueueOverflow::Reject;
+    bool m_simplifyQueue = false;
 
-    std::vector<Sticker> m_stickers;                       
+    // Sticker store, one PackedSticker per sticker in the fixed export order. Positions are
+    // doubled and centred so they stay integral (and fit int8) for every size: component
+    // c = 2 * layer - (size - 1), i.e. in {-(size-1), ..., size-1} with step 2.
+    // A sticker's resting transform (its baseModel) is m_geometry's orientation for its face
+    // translated to its position, built when needed rather than stored.
+    std::vector<PackedSticker> m_stickers;
+    StickerGeometry m_geometry;
+    // m_layerMembers[axis][layer]: indices of stickers in that layer along axis (0=x,1=y,2=z);
+    // m_memberSlot[axis][i] is sticker i's position in its list, so moving a sticker between
+    // layers is O(1). A turn visits size*size + 4*size stickers (outer) or 4*size (inner).
+    std::vector<std::vector<uint16_t>> m_layerMembers[3];
+    std::vector<uint16_t> m_memberSlot[3];
+    // stickerModelMatrices() buffer, allocated on its first call (renderers using
+    // writeStickerTransforms()/writePackedStickers() never pay for it); holds the baseModel
+    // for resting stickers. m_pendingBase lists stickers moved by the headless path whose
+    // entry hasn't been rebuilt yet.
+    std::vector<glm::mat4> m_modelMatrices;
+    std::vector<uint16_t> m_pendingBase;
+    std::vector<uint8_t> m_basePending;
+    mutable std::vector<glm::vec3> m_colors; // stickerColors() buffer, built on its first call
+    uint64_t m_generation = 0;
+    uint64_t m_restGeneration = 0;          // bumped when any baseModel/cubePos changes
+    bool m_matricesDirty = true;            // m_modelMatrices out of date
+    bool m_cubieValid = false;              // m_cubie mirrors the stickers (3x3, outer turns only)
+    bool m_stickersStale = false;           // m_cubie moved on without the sticker view (headless path)
+    // Zobrist state: m_hash is the XOR of m_stickerKey, each sticker's key at its current
+    // facelet. Kept by the sticker path only; while m_cubieValid the hash comes from m_cubie.
+    uint64_t m_hash = 0;
+    std::vector<uint64_t> m_stickerKey;
+    const uint64_t* m_zobrist = nullptr;    // shared key table for m_size, [facelet * 6 + color]
+    std::vector<LayerTurn> m_parseBuffer;   // reused by applySequence(const std::string&) and catchUpBacklog()
+    double m_clock = 0.0;                   // clockSeconds()
+    uint64_t m_landedTurns = 0;             // landedTurnCount()
+    MoveLogWriter* m_recorder = nullptr;
 
  
     void buildInitialStickers();
-    void rebuildBaseModel(Sticker& s);
-    void startParsedMove(char face, int amount, bool prime);
-    bool parseMove(const std::string& move, char& face, int& amount, bool& prime);
-    void applyRotationDiscrete(const glm::vec3& axis, int layer, float angleDeg);
-    glm::vec3 faceToColor(char face) const;
+    void writeBaseModel(size_t idx, glm::mat4& out) const;
+    void startMove(const LayerTurn& turn);
+    void applyTurnDiscrete(const LayerTurn& turn);
+    void landTurn(const LayerTurn& turn);
     void startNextInQueue();
+    void catchUpBacklog();
+    bool canStartAlongside(const LayerTurn& turn) const;
+    void beginAnimation(const LayerTurn& turn);
+    bool mergeIntoQueue(const LayerTurn& turn);
+    bool pushSubmission(const LayerTurn& turn);
+    void refreshModelMatrices();
+    void rebuildLayerIndex(int axisIdx);
+    void moveLayerMember(int axisIdx, uint16_t idx, int fromLayer, int toLayer);
+    int layerOf(int coord) const;
+    void markTransformsDirty();
+    void markRestChanged();
+    glm::mat4 layerModelMatrix(const Anim& anim) const;
+    void finishAnimationInstantly();
+    void syncStickersFromCubie();
+    void leaveCubieState();
+    void flushPendingBaseModels();
+    void ensureStickerView();
+    void drainSubmissions();
 };
 
 #endif // CORE_H
\ No newline at end of file
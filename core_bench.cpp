@@ -0,0 +1,380 @@
+// core_bench - Google Benchmark suite for Core's hot paths and the batch state engines
+// - Headless: no window or GL context; Core only builds its CPU-side buffers
+// - Every benchmark that turns the cube reports items_per_second (moves or stickers per second),
+//   so runs from different releases compare directly
+// - Inputs come from ScrambleGenerator with fixed seeds, so every run measures the same work
+// Usage:
+//   core_bench                                                   // console table
+//   core_bench --benchmark_format=json > core_bench.json         // for regression tracking
+//   core_bench --benchmark_filter=Engine --benchmark_out=engines.json --benchmark_out_format=json
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "compiled_sequence.h"
+#include "core.h"
+#include "cubie.h"
+#include "facelet.h"
+#include "move.h"
+#include "move_log.h"
+#include "scramble.h"
+
+namespace {
+
+const uint64_t SEED = 20261014;
+const size_t TURN_POOL = 4096; // precomputed turns cycled through by the per-turn benchmarks
+
+std::vector<Move> randomMoves(size_t count)
+{
+    std::vector<Move> moves(count);
+    ScrambleGenerator(SEED).randomMoveScramble(0, (int)count, moves.data());
+    return moves;
+}
+
+// outer and wide turns plus inner slices, so the sticker path sees every layer
+std::vector<LayerTurn> randomTurns(int size, size_t count)
+{
+    std::vector<LayerTurn> turns(count);
+    ScrambleGenerator(SEED).randomMoveScramble(0, size, (int)count, turns.data());
+    CounterRng rng(SEED, (uint64_t)size);
+    for (size_t i = 0; i < count; i += 3) {
+        uint8_t layer = (uint8_t)rng.below((uint32_t)size);
+        turns[i].first = turns[i].last = layer;
+    }
+    return turns;
+}
+
+// leave the cubie model, so 3x3 turns take the sticker path too
+void useStickerPath(Core& core)
+{
+    core.applySequence("M M'");
+}
+
+// ---- parsing ----
+
+void BM_ParseMoveToken(benchmark::State& state)
+{
+    static const char* tokens[] = {"U", "R'", "F2", "D", "L'", "B2", "u", "R2'"};
+    size_t i = 0;
+    for (auto _ : state) {
+        Move m;
+        const char* t = tokens[i++ & 7];
+        benchmark::DoNotOptimize(parseMoveToken(t, strlen(t), m));
+        benchmark::DoNotOptimize(m);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParseMoveToken);
+
+// Arg: cube size; 3x3 reads plain face turns, bigger cubes a mix with wide and slice forms
+void BM_ParseLayerTurnSequence(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::string text;
+    if (size == 3) {
+        std::vector<Move> moves = randomMoves(1000);
+        text = formatMoveSequence(moves.data(), moves.size());
+    } else {
+        static const char* tokens[] = {"R", "Uw'", "3Fw2", "2R", "M2", "L'", "3Dw", "Bw2"};
+        for (int i = 0; i < 1000; ++i) text += std::string(tokens[i & 7]) + " ";
+    }
+    std::vector<LayerTurn> out;
+    if (!parseLayerTurnSequence(text, size, out)) {
+        state.SkipWithError("benchmark text does not parse");
+        return;
+    }
+    size_t count = out.size();
+    for (auto _ : state) {
+        out.clear();
+        benchmark::DoNotOptimize(parseLayerTurnSequence(text, size, out));
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+    state.SetBytesProcessed(state.iterations() * (int64_t)text.size());
+}
+BENCHMARK(BM_ParseLayerTurnSequence)->Arg(3)->Arg(7);
+
+// ---- queue ----
+
+// Arg: moves queued per iteration (queue sized to fit), then dropped
+void BM_QueueMove(benchmark::State& state)
+{
+    size_t count = (size_t)state.range(0);
+    std::vector<Move> moves = randomMoves(count);
+    Core core;
+    core.setQueueCapacity(count);
+    for (auto _ : state) {
+        for (Move m : moves) core.queueMove(m);
+        core.clearQueue();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+}
+BENCHMARK(BM_QueueMove)->Arg(4096)->Arg(1 << 16);
+
+// Arg: queued moves, then drained by update() steps that finish one animation each (start
+// next in queue, animate, land)
+void BM_QueueDrain(benchmark::State& state)
+{
+    size_t count = (size_t)state.range(0);
+    std::vector<Move> moves = randomMoves(count);
+    Core core;
+    core.setQueueCapacity(count);
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (Move m : moves) core.queueMove(m);
+        state.ResumeTiming();
+        while (core.isAnimating() || core.queuedMoveCount() > 0) core.update(1.0f);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+}
+BENCHMARK(BM_QueueDrain)->Arg(4096)->Arg(1 << 16);
+
+// ---- discrete turns and transforms ----
+
+// Arg: cube size. One headless layer turn on the sticker path (applyTurnDiscrete()).
+void BM_ApplyTurnDiscrete(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, TURN_POOL);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    useStickerPath(core);
+    size_t i = 0;
+    for (auto _ : state) {
+        core.applySequence(&turns[i], 1);
+        i = (i + 1) % TURN_POOL;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["stickers"] = (double)core.stickerCount();
+}
+BENCHMARK(BM_ApplyTurnDiscrete)->Arg(3)->Arg(5)->Arg(9)->Arg(17)->Arg(33);
+
+// Arg: cube size. A turn, then stickerModelMatrices(): the moved stickers' resting matrices
+// are rebuilt (flushPendingBaseModels() / writeBaseModel()).
+void BM_RebuildBaseModels(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, TURN_POOL);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    useStickerPath(core);
+    core.stickerModelMatrices();
+    size_t i = 0;
+    for (auto _ : state) {
+        core.applySequence(&turns[i], 1);
+        benchmark::DoNotOptimize(core.stickerModelMatrices().data());
+        i = (i + 1) % TURN_POOL;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RebuildBaseModels)->Arg(3)->Arg(9)->Arg(33);
+
+// Arg: cube size. Export with nothing changed since the last call.
+void BM_StickerModelMatricesIdle(benchmark::State& state)
+{
+    Core core(1.0f, 0.03f, 360.0f, (int)state.range(0));
+    core.stickerModelMatrices();
+    for (auto _ : state) benchmark::DoNotOptimize(core.stickerModelMatrices().data());
+    state.SetItemsProcessed(state.iterations() * (int64_t)core.stickerCount());
+}
+BENCHMARK(BM_StickerModelMatricesIdle)->Arg(3)->Arg(33);
+
+// Arg: cube size. One animation frame, then the export (turning layers recomputed).
+void BM_StickerModelMatricesAnimating(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, TURN_POOL);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    core.setQueueOverflow(Core::QueueOverflow::ApplyOldest);
+    size_t i = 0;
+    for (auto _ : state) {
+        if (!core.isAnimating()) {
+            core.queueMove(turns[i]);
+            i = (i + 1) % TURN_POOL;
+        }
+        core.update(1.0f / 240.0f);
+        benchmark::DoNotOptimize(core.stickerModelMatrices().data());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)core.stickerCount());
+}
+BENCHMARK(BM_StickerModelMatricesAnimating)->Arg(3)->Arg(33);
+
+// Arg: cube size. Compact export used by the renderer after a turn lands.
+void BM_WritePackedStickers(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, TURN_POOL);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    std::vector<PackedSticker> out(core.stickerCount());
+    size_t i = 0;
+    for (auto _ : state) {
+        core.applySequence(&turns[i], 1);
+        benchmark::DoNotOptimize(core.writePackedStickers(out.data(), out.size()));
+        i = (i + 1) % TURN_POOL;
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)core.stickerCount());
+}
+BENCHMARK(BM_WritePackedStickers)->Arg(3)->Arg(33);
+
+// ---- state engines: moves per second ----
+
+const size_t ENGINE_MOVES = 1 << 16;
+
+void BM_EngineCubieCube(benchmark::State& state)
+{
+    std::vector<Move> moves = randomMoves(ENGINE_MOVES);
+    CubieCube c;
+    for (auto _ : state) {
+        c.applySequence(moves.data(), moves.size());
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)moves.size());
+}
+BENCHMARK(BM_EngineCubieCube);
+
+void BM_EngineCubieCubeHashed(benchmark::State& state)
+{
+    std::vector<Move> moves = randomMoves(ENGINE_MOVES);
+    CubieCube c;
+    uint64_t h = c.hash();
+    for (auto _ : state) {
+        c.applySequence(moves.data(), moves.size(), h);
+        benchmark::DoNotOptimize(h);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)moves.size());
+}
+BENCHMARK(BM_EngineCubieCubeHashed);
+
+void BM_EngineFaceletCube(benchmark::State& state)
+{
+    std::vector<Move> moves = randomMoves(ENGINE_MOVES);
+    FaceletCube f;
+    for (auto _ : state) {
+        f.applySequence(moves.data(), moves.size());
+        benchmark::DoNotOptimize(f);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)moves.size());
+    state.SetLabel(FaceletCube::kernelName());
+}
+BENCHMARK(BM_EngineFaceletCube);
+
+// Core on 3x3 outer moves: the cubie model
+void BM_EngineCoreCubie(benchmark::State& state)
+{
+    std::vector<Move> moves = randomMoves(ENGINE_MOVES);
+    Core core;
+    for (auto _ : state) {
+        core.applySequence(moves.data(), moves.size());
+        benchmark::DoNotOptimize(core.stateHash());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)moves.size());
+}
+BENCHMARK(BM_EngineCoreCubie);
+
+// Arg: cube size. Core's sticker path, batched.
+void BM_EngineCoreStickers(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, ENGINE_MOVES);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    useStickerPath(core);
+    for (auto _ : state) {
+        core.applySequence(turns.data(), turns.size());
+        benchmark::DoNotOptimize(core.stateHash());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)turns.size());
+}
+BENCHMARK(BM_EngineCoreStickers)->Arg(3)->Arg(5)->Arg(17);
+
+// A 14-move algorithm compiled once, applied to a CubieCube / a sticker-path Core; items are
+// the moves it stands for.
+void BM_EngineCompiledCubie(benchmark::State& state)
+{
+    CompiledSequence alg;
+    CompiledSequence::compile("R U R' U' R' F R2 U' R' U' R U R' F'", 3, alg);
+    CubieCube c;
+    for (auto _ : state) {
+        alg.applyTo(c);
+        benchmark::DoNotOptimize(c);
+    }
+    state.SetItemsProcessed(state.iterations() * 14);
+}
+BENCHMARK(BM_EngineCompiledCubie);
+
+void BM_EngineCompiledStickers(benchmark::State& state)
+{
+    int size = (int)state.range(0);
+    std::vector<LayerTurn> turns = randomTurns(size, 64);
+    CompiledSequence alg = CompiledSequence::compile(turns.data(), turns.size(), size);
+    Core core(1.0f, 0.03f, 360.0f, size);
+    useStickerPath(core);
+    for (auto _ : state) {
+        core.applyCompiled(alg);
+        benchmark::DoNotOptimize(core.stateHash());
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)turns.size());
+}
+BENCHMARK(BM_EngineCompiledStickers)->Arg(3)->Arg(17);
+
+// Replaying a recorded move log (decode + batched headless turns).
+void BM_EngineMoveLogReplay(benchmark::State& state)
+{
+    const char* path = "core_bench_replay.rcml";
+    std::vector<Move> moves = randomMoves(ENGINE_MOVES);
+    {
+        Core rec;
+        MoveLogWriter log;
+        log.open(path, rec);
+        rec.setMoveRecorder(&log);
+        rec.applySequence(moves.data(), moves.size());
+        rec.setMoveRecorder(nullptr);
+        log.close();
+    }
+    MoveLogReader reader;
+    if (!reader.open(path)) {
+        state.SkipWithError("could not write the move log");
+        return;
+    }
+    Core core;
+    for (auto _ : state) {
+        reader.seekCheckpoint(0, core);
+        benchmark::DoNotOptimize(reader.applyTurns(core));
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)moves.size());
+    reader.close();
+    std::remove(path);
+}
+BENCHMARK(BM_EngineMoveLogReplay);
+
+// ---- scramble generation ----
+
+void BM_RandomStates(benchmark::State& state)
+{
+    ScrambleGenerator gen(SEED);
+    std::vector<CubieCube> out(1024);
+    uint64_t first = 0;
+    for (auto _ : state) {
+        gen.randomStates(first, out.size(), out.data());
+        first += out.size();
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)out.size());
+}
+BENCHMARK(BM_RandomStates);
+
+void BM_RandomMoveScrambles(benchmark::State& state)
+{
+    ScrambleGenerator gen(SEED);
+    std::vector<Move> out(1024 * 25);
+    uint64_t first = 0;
+    for (auto _ : state) {
+        gen.randomMoveScrambles(first, 1024, 25, out.data());
+        first += 1024;
+    }
+    state.SetItemsProcessed(state.iterations() * 1024);
+}
+BENCHMARK(BM_RandomMoveScrambles);
+
+} // namespace
+
+BENCHMARK_MAIN();
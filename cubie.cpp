@@ -0,0 +1,321 @@
+#include "cubie.h"
+#include "zobrist.h"
+
+#include <cstring>
+
+// facelet indices in Core order (face * 9 + row-major index from buildInitialStickers())
+const uint8_t CubieCube::CORNER_FACELETS[8][3] = {
+    { 6, 15, 24}, { 0, 18, 42}, { 2, 36, 45}, { 8, 51,  9},
+    {33, 26, 17}, {27, 44, 20}, {29, 47, 38}, {35, 11, 53}
+};
+const uint8_t CubieCube::EDGE_FACELETS[12][2] = {
+    { 7, 12}, { 3, 21}, { 1, 39}, { 5, 48}, {34, 14}, {30, 23},
+    {28, 41}, {32, 50}, {25, 16}, {19, 43}, {46, 37}, {52, 10}
+};
+
+namespace {
+
+struct RawCube {
+    uint8_t cp[8], co[8], ep[12], eo[12];
+};
+
+// Clockwise quarter turns of each face, in U R F D L B order.
+const RawCube BASIC_MOVES[6] = {
+    // U
+    {{3, 0, 1, 2, 4, 5, 6, 7}, {0, 0, 0, 0, 0, 0, 0, 0},
+     {3, 0, 1, 2, 4, 5, 6, 7, 8, 9, 10, 11}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    // R
+    {{4, 1, 2, 0, 7, 5, 6, 3}, {2, 0, 0, 1, 1, 0, 0, 2},
+     {8, 1, 2, 3, 11, 5, 6, 7, 4, 9, 10, 0}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    // F
+    {{1, 5, 2, 3, 0, 4, 6, 7}, {1, 2, 0, 0, 2, 1, 0, 0},
+     {0, 9, 2, 3, 4, 8, 6, 7, 1, 5, 10, 11}, {0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 0}},
+    // D
+    {{0, 1, 2, 3, 5, 6, 7, 4}, {0, 0, 0, 0, 0, 0, 0, 0},
+     {0, 1, 2, 3, 5, 6, 7, 4, 8, 9, 10, 11}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    // L
+    {{0, 2, 6, 3, 4, 1, 5, 7}, {0, 1, 2, 0, 0, 2, 1, 0},
+     {0, 1, 10, 3, 4, 5, 9, 7, 8, 2, 6, 11}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+    // B
+    {{0, 1, 3, 7, 4, 5, 2, 6}, {0, 0, 1, 2, 0, 0, 2, 1},
+     {0, 1, 2, 11, 4, 5, 6, 10, 8, 9, 3, 7}, {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1}},
+};
+
+constexpr RawCube multiplyRaw(const RawCube& a, const RawCube& b)
+{
+    RawCube r{};
+    for (int i = 0; i < 8; ++i) {
+        r.cp[i] = a.cp[b.cp[i]];
+        r.co[i] = (uint8_t)((a.co[b.cp[i]] + b.co[i]) % 3);
+    }
+    for (int i = 0; i < 12; ++i) {
+        r.ep[i] = a.ep[b.ep[i]];
+        r.eo[i] = (uint8_t)((a.eo[b.ep[i]] + b.eo[i]) & 1);
+    }
+    return r;
+}
+
+// 18-entry move table: row face*3 + k is the k+1 quarter-turn power of the basic move
+struct MoveTable {
+    CubieCube moves[kMoveCount];
+    MoveTable()
+    {
+        for (int f = 0; f < 6; ++f) {
+            RawCube p = BASIC_MOVES[f];
+            for (int k = 0; k < 3; ++k) {
+                CubieCube& c = moves[f * 3 + k];
+                memcpy(c.cp, p.cp, 8); memcpy(c.co, p.co, 8);
+                memcpy(c.ep, p.ep, 12); memcpy(c.eo, p.eo, 12);
+                p = multiplyRaw(p, BASIC_MOVES[f]);
+            }
+        }
+    }
+};
+
+const MoveTable& moveTable()
+{
+    static const MoveTable table;
+    return table;
+}
+
+// (a + b) % 3 for a, b in 0..2 without a division
+const uint8_t MOD3[6] = { 0, 1, 2, 0, 1, 2 };
+
+// Zobrist keys folded per cubie: corner[slot][cubie][twist] is the XOR of the keys of the
+// three colors that cubie shows in that slot (same for edges), so a hash update is one lookup
+// per moved cubie. moved* list the slots each move changes.
+struct HashTable {
+    uint64_t corner[8][8][3];
+    uint64_t edge[12][12][2];
+    uint64_t centers;
+    uint8_t movedCorners[kMoveCount][4];
+    uint8_t movedEdges[kMoveCount][4];
+
+    HashTable()
+    {
+        for (int i = 0; i < 8; ++i)
+            for (int c = 0; c < 8; ++c)
+                for (int o = 0; o < 3; ++o) {
+                    uint64_t h = 0;
+                    for (int k = 0; k < 3; ++k)
+                        h ^= zobristKey(3, CubieCube::CORNER_FACELETS[i][(k + o) % 3], CubieCube::CORNER_FACELETS[c][k] / 9);
+                    corner[i][c][o] = h;
+                }
+        for (int i = 0; i < 12; ++i)
+            for (int e = 0; e < 12; ++e)
+                for (int o = 0; o < 2; ++o) {
+                    uint64_t h = 0;
+                    for (int k = 0; k < 2; ++k)
+                        h ^= zobristKey(3, CubieCube::EDGE_FACELETS[i][(k + o) & 1], CubieCube::EDGE_FACELETS[e][k] / 9);
+                    edge[i][e][o] = h;
+                }
+        centers = 0;
+        for (int f = 0; f < 6; ++f) centers ^= zobristKey(3, f * 9 + 4, f);
+
+        for (int m = 0; m < kMoveCount; ++m) {
+            const CubieCube& b = moveTable().moves[m];
+            int nc = 0, ne = 0;
+            for (int i = 0; i < 8; ++i)
+                if (b.cp[i] != i || b.co[i] != 0) movedCorners[m][nc++] = (uint8_t)i;
+            for (int i = 0; i < 12; ++i)
+                if (b.ep[i] != i || b.eo[i] != 0) movedEdges[m][ne++] = (uint8_t)i;
+        }
+    }
+};
+
+const HashTable& hashTable()
+{
+    static const HashTable table;
+    return table;
+}
+
+uint64_t movedCubiesHash(const CubieCube& c, const HashTable& t, int m)
+{
+    uint64_t h = 0;
+    for (int k = 0; k < 4; ++k) {
+        int i = t.movedCorners[m][k], j = t.movedEdges[m][k];
+        h ^= t.corner[i][c.cp[i]][c.co[i]] ^ t.edge[j][c.ep[j]][c.eo[j]];
+    }
+    return h;
+}
+
+} // namespace
+
+CubieCube::CubieCube()
+{
+    for (uint8_t i = 0; i < 8; ++i) { cp[i] = i; co[i] = 0; }
+    for (uint8_t i = 0; i < 12; ++i) { ep[i] = i; eo[i] = 0; }
+}
+
+const CubieCube& CubieCube::moveCube(Move m)
+{
+    return moveTable().moves[(int)m];
+}
+
+void CubieCube::multiply(const CubieCube& b)
+{
+    uint8_t ncp[8], nco[8], nep[12], neo[12];
+    for (int i = 0; i < 8; ++i) {
+        ncp[i] = cp[b.cp[i]];
+        nco[i] = MOD3[co[b.cp[i]] + b.co[i]];
+    }
+    for (int i = 0; i < 12; ++i) {
+        nep[i] = ep[b.ep[i]];
+        neo[i] = eo[b.ep[i]] ^ b.eo[i];
+    }
+    memcpy(cp, ncp, 8); memcpy(co, nco, 8);
+    memcpy(ep, nep, 12); memcpy(eo, neo, 12);
+}
+
+void CubieCube::applyMove(Move m)
+{
+    multiply(moveTable().moves[(int)m]);
+}
+
+void CubieCube::applySequence(const Move* moves, size_t count)
+{
+    const MoveTable& table = moveTable();
+    for (size_t i = 0; i < count; ++i) multiply(table.moves[(int)moves[i]]);
+}
+
+uint64_t CubieCube::hash() const
+{
+    const HashTable& t = hashTable();
+    uint64_t h = t.centers;
+    for (int i = 0; i < 8; ++i) h ^= t.corner[i][cp[i]][co[i]];
+    for (int i = 0; i < 12; ++i) h ^= t.edge[i][ep[i]][eo[i]];
+    return h;
+}
+
+void CubieCube::applyMove(Move m, uint64_t& hash)
+{
+    const HashTable& t = hashTable();
+    hash ^= movedCubiesHash(*this, t, (int)m);
+    multiply(moveTable().moves[(int)m]);
+    hash ^= movedCubiesHash(*this, t, (int)m);
+}
+
+void CubieCube::applySequence(const Move* moves, size_t count, uint64_t& hash)
+{
+    const MoveTable& table = moveTable();
+    const HashTable& t = hashTable();
+    uint64_t h = hash;
+    for (size_t i = 0; i < count; ++i) {
+        int m = (int)moves[i];
+        h ^= movedCubiesHash(*this, t, m);
+        multiply(table.moves[m]);
+        h ^= movedCubiesHash(*this, t, m);
+    }
+    hash = h;
+}
+
+CubieCube CubieCube::inverse() const
+{
+    CubieCube r;
+    for (int i = 0; i < 8; ++i) {
+        r.cp[cp[i]] = (uint8_t)i;
+        r.co[cp[i]] = MOD3[3 - co[i]];
+    }
+    for (int i = 0; i < 12; ++i) {
+        r.ep[ep[i]] = (uint8_t)i;
+        r.eo[ep[i]] = eo[i];
+    }
+    return r;
+}
+
+bool CubieCube::isSolved() const
+{
+    return *this == CubieCube();
+}
+
+static int permutationParity(const uint8_t* p, int n)
+{
+    int parity = 0;
+    for (int i = 0; i < n; ++i)
+        for (int j = i + 1; j < n; ++j)
+            if (p[i] > p[j]) parity ^= 1;
+    return parity;
+}
+
+bool CubieCube::isValid() const
+{
+    int seenC = 0, seenE = 0, twist = 0, flip = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (cp[i] >= 8 || co[i] >= 3) return false;
+        seenC |= 1 << cp[i];
+        twist += co[i];
+    }
+    for (int i = 0; i < 12; ++i) {
+        if (ep[i] >= 12 || eo[i] >= 2) return false;
+        seenE |= 1 << ep[i];
+        flip += eo[i];
+    }
+    if (seenC != 0xFF || seenE != 0xFFF) return false;
+    if (twist % 3 != 0 || flip % 2 != 0) return false;
+    return permutationParity(cp, 8) == permutationParity(ep, 12);
+}
+
+bool CubieCube::operator==(const CubieCube& o) const
+{
+    return memcmp(cp, o.cp, 8) == 0 && memcmp(co, o.co, 8) == 0 &&
+           memcmp(ep, o.ep, 12) == 0 && memcmp(eo, o.eo, 12) == 0;
+}
+
+void CubieCube::toFaceletPermutation(uint8_t src[54]) const
+{
+    // centers never move
+    for (uint8_t f = 0; f < 6; ++f) src[f * 9 + 4] = f * 9 + 4;
+    for (int i = 0; i < 8; ++i) {
+        for (int k = 0; k < 3; ++k)
+            src[CORNER_FACELETS[i][(k + co[i]) % 3]] = CORNER_FACELETS[cp[i]][k];
+    }
+    for (int i = 0; i < 12; ++i) {
+        for (int k = 0; k < 2; ++k)
+            src[EDGE_FACELETS[i][(k + eo[i]) & 1]] = EDGE_FACELETS[ep[i]][k];
+    }
+}
+
+void CubieCube::toFacelets(uint8_t faceIds[54]) const
+{
+    uint8_t src[54];
+    toFaceletPermutation(src);
+    for (int i = 0; i < 54; ++i) faceIds[i] = src[i] / 9;
+}
+
+bool CubieCube::fromFacelets(const uint8_t faceIds[54], CubieCube& out)
+{
+    for (int f = 0; f < 6; ++f)
+        if (faceIds[f * 9 + 4] != f) return false;
+
+    for (int i = 0; i < 8; ++i) {
+        // the U/D colored facelet tells the twist
+        int ori = 0;
+        for (; ori < 3; ++ori) {
+            uint8_t c = faceIds[CORNER_FACELETS[i][ori]];
+            if (c == 0 || c == 3) break;
+        }
+        if (ori == 3) return false;
+        uint8_t c1 = faceIds[CORNER_FACELETS[i][(ori + 1) % 3]];
+        uint8_t c2 = faceIds[CORNER_FACELETS[i][(ori + 2) % 3]];
+        int j = 0;
+        for (; j < 8; ++j) {
+            if (c1 == CORNER_FACELETS[j][1] / 9 && c2 == CORNER_FACELETS[j][2] / 9) break;
+        }
+        if (j == 8) return false;
+        out.cp[i] = (uint8_t)j;
+        out.co[i] = (uint8_t)ori;
+    }
+    for (int i = 0; i < 12; ++i) {
+        uint8_t a = faceIds[EDGE_FACELETS[i][0]];
+        uint8_t b = faceIds[EDGE_FACELETS[i][1]];
+        int j = 0;
+        for (; j < 12; ++j) {
+            uint8_t ja = EDGE_FACELETS[j][0] / 9, jb = EDGE_FACELETS[j][1] / 9;
+            if (a == ja && b == jb) { out.eo[i] = 0; break; }
+            if (a == jb && b == ja) { out.eo[i] = 1; break; }
+        }
+        if (j == 12) return false;
+        out.ep[i] = (uint8_t)j;
+    }
+    return out.isValid();
+}
@@ -0,0 +1,69 @@
+#ifndef CUBIE_H
+#define CUBIE_H
+
+// CubieCube - compact 3x3 state: permutation + orientation of 8 corners and 12 edges
+// - 40 bytes, no floats; a face turn is one pass over precomputed move tables
+// - Corner slots: URF UFL ULB UBR DFR DLF DBL DRB, edge slots: UR UF UL UB DR DF DL DB FR FL BL BR
+//   cp[i]/ep[i] = which cubie sits in slot i, co[i] in 0..2 / eo[i] in 0..1 = its twist/flip
+// - Facelet views use Core's sticker order (U,R,F,D,L,B x 9, as built by buildInitialStickers()),
+//   so facelet index i is the resting place of Core sticker i on a solved cube.
+// Usage:
+//   CubieCube c;                     // solved
+//   c.applyMove(Move::R);
+//   c.applySequence(moves.data(), moves.size());
+//   uint8_t faces[54]; c.toFacelets(faces);
+//   uint64_t h = c.hash(); c.applyMove(Move::U, h); // h == c.hash()
+//
+// No GL and no GLM here; intended for bulk/offline work as well as Core.
+
+#include <cstdint>
+#include <cstddef>
+#include "move.h"
+
+struct CubieCube {
+    uint8_t cp[8];
+    uint8_t co[8];
+    uint8_t ep[12];
+    uint8_t eo[12];
+
+    CubieCube(); // solved
+
+    // this = this * b, i.e. apply b's permutation after the current state
+    void multiply(const CubieCube& b);
+    void applyMove(Move m);
+    void applySequence(const Move* moves, size_t count);
+
+    CubieCube inverse() const;
+
+    // Zobrist hash of the facelet colors (zobrist.h), equal to FaceletCube::hash() and
+    // Core::stateHash() for the same state. Not stored: callers that want it maintained keep
+    // it next to the cube and use the applyMove/applySequence overloads below.
+    uint64_t hash() const;
+    // Same as applyMove/applySequence, and update `hash` (hash() before the call) from the
+    // eight cubies each move displaces.
+    void applyMove(Move m, uint64_t& hash);
+    void applySequence(const Move* moves, size_t count, uint64_t& hash);
+
+    bool isSolved() const;
+    // true if the state is reachable by face turns (valid permutations, twist/flip sums, parity)
+    bool isValid() const;
+
+    bool operator==(const CubieCube& o) const;
+    bool operator!=(const CubieCube& o) const { return !(*this == o); }
+
+    // faceIds[i] = face (0..5, U R F D L B) whose color shows at facelet i
+    void toFacelets(uint8_t faceIds[54]) const;
+    // src[i] = facelet index (equivalently Core sticker index) that now sits at facelet i
+    void toFaceletPermutation(uint8_t src[54]) const;
+    // inverse of toFacelets; returns false if the colors don't describe a cube
+    static bool fromFacelets(const uint8_t faceIds[54], CubieCube& out);
+
+    // the state reached from solved by a single move (a row of the move table)
+    static const CubieCube& moveCube(Move m);
+
+    // facelet indices of each slot, U/D facelet first then clockwise around the cubie
+    static const uint8_t CORNER_FACELETS[8][3];
+    static const uint8_t EDGE_FACELETS[12][2];
+};
+
+#endif // CUBIE_H
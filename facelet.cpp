@@ -0,0 +1,273 @@
+#include "facelet.h"
+#include "cubie.h"
+#include "zobrist.h"
+
+#include <cstring>
+
+// x86: the pshufb kernels are built whatever the compiler's default target is and picked at
+// run time from what the CPU supports (GCC/Clang compile each one with a target attribute;
+// MSVC allows the intrinsics without /arch)
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FACELET_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define FACELET_TARGET(isa) __attribute__((target(isa)))
+#else
+#define FACELET_TARGET(isa)
+#endif
+#endif
+
+namespace {
+
+// Per move: src[p] = position whose facelet moves to p (padding maps to itself).
+// shuffle[j][k] = pshufb control that picks, for output chunk k (bytes 16k..16k+15), the
+// bytes coming from source chunk j; every other lane is 0x80 so the four partial results can
+// simply be OR-ed together. Stored source-major so shuffle[j][2x..2x+1] is one 32-byte AVX2 mask.
+struct ShuffleTable {
+    uint8_t src[kMoveCount][64];
+    alignas(32) uint8_t shuffle[kMoveCount][4][4][16];
+    uint8_t moved[kMoveCount][20];  // the positions each move changes
+    uint64_t key[54][6];            // zobristKey(3, position, color)
+
+    ShuffleTable()
+    {
+        for (int m = 0; m < kMoveCount; ++m) {
+            uint8_t perm[54];
+            CubieCube::moveCube((Move)m).toFaceletPermutation(perm);
+            for (int p = 0; p < 64; ++p) src[m][p] = p < 54 ? perm[p] : (uint8_t)p;
+
+            memset(shuffle[m], 0x80, sizeof(shuffle[m]));
+            for (int p = 0; p < 64; ++p) {
+                int s = src[m][p];
+                shuffle[m][s >> 4][p >> 4][p & 15] = (uint8_t)(s & 15);
+            }
+            int n = 0;
+            for (int p = 0; p < 54; ++p)
+                if (src[m][p] != p) moved[m][n++] = (uint8_t)p;
+        }
+        for (int p = 0; p < 54; ++p)
+            for (int c = 0; c < 6; ++c) key[p][c] = zobristKey(3, p, c);
+    }
+};
+
+const ShuffleTable& shuffleTable()
+{
+    static const ShuffleTable table;
+    return table;
+}
+
+void shuffleMoveScalar(uint8_t* f, const ShuffleTable& t, int m)
+{
+    uint8_t old[64];
+    memcpy(old, f, 64);
+    for (int p = 0; p < 54; ++p) f[p] = old[t.src[m][p]];
+}
+
+uint64_t movedFaceletsHash(const uint8_t* f, const ShuffleTable& t, int m)
+{
+    uint64_t h = 0;
+    for (int k = 0; k < 20; ++k) {
+        int p = t.moved[m][k];
+        h ^= t.key[p][f[p] / 9];
+    }
+    return h;
+}
+
+// Applies moves[0..count) to f, and keeps *hash up to date when it is not null.
+typedef void (*MoveKernel)(uint8_t* f, const ShuffleTable& t, const Move* moves, size_t count, uint64_t* hash);
+
+void applyMovesScalar(uint8_t* f, const ShuffleTable& t, const Move* moves, size_t count, uint64_t* hash)
+{
+    for (size_t i = 0; i < count; ++i) {
+        int m = (int)moves[i];
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+        shuffleMoveScalar(f, t, m);
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+    }
+}
+
+#if defined(FACELET_X86)
+FACELET_TARGET("avx2") inline void shuffleMoveAvx2(uint8_t* f, const ShuffleTable& t, int m)
+{
+    __m256i a = _mm256_load_si256((const __m256i*)f);
+    __m256i b = _mm256_load_si256((const __m256i*)(f + 32));
+    // each source chunk broadcast to both 128-bit lanes, since vpshufb cannot cross lanes
+    __m256i srcs[4] = {
+        _mm256_permute2x128_si256(a, a, 0x00), _mm256_permute2x128_si256(a, a, 0x11),
+        _mm256_permute2x128_si256(b, b, 0x00), _mm256_permute2x128_si256(b, b, 0x11)
+    };
+    __m256i out[2];
+    for (int x = 0; x < 2; ++x) {
+        __m256i r = _mm256_shuffle_epi8(srcs[0], _mm256_load_si256((const __m256i*)t.shuffle[m][0][2 * x]));
+        for (int j = 1; j < 4; ++j)
+            r = _mm256_or_si256(r, _mm256_shuffle_epi8(srcs[j], _mm256_load_si256((const __m256i*)t.shuffle[m][j][2 * x])));
+        out[x] = r;
+    }
+    _mm256_store_si256((__m256i*)f, out[0]);
+    _mm256_store_si256((__m256i*)(f + 32), out[1]);
+}
+
+FACELET_TARGET("ssse3") inline void shuffleMoveSsse3(uint8_t* f, const ShuffleTable& t, int m)
+{
+    __m128i srcs[4];
+    for (int j = 0; j < 4; ++j) srcs[j] = _mm_load_si128((const __m128i*)(f + 16 * j));
+    for (int k = 0; k < 4; ++k) {
+        __m128i r = _mm_shuffle_epi8(srcs[0], _mm_load_si128((const __m128i*)t.shuffle[m][0][k]));
+        for (int j = 1; j < 4; ++j)
+            r = _mm_or_si128(r, _mm_shuffle_epi8(srcs[j], _mm_load_si128((const __m128i*)t.shuffle[m][j][k])));
+        _mm_store_si128((__m128i*)(f + 16 * k), r);
+    }
+}
+
+// the loop lives in each kernel so the shuffle inlines into code built for its ISA
+FACELET_TARGET("avx2") void applyMovesAvx2(uint8_t* f, const ShuffleTable& t, const Move* moves, size_t count, uint64_t* hash)
+{
+    for (size_t i = 0; i < count; ++i) {
+        int m = (int)moves[i];
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+        shuffleMoveAvx2(f, t, m);
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+    }
+}
+
+FACELET_TARGET("ssse3") void applyMovesSsse3(uint8_t* f, const ShuffleTable& t, const Move* moves, size_t count, uint64_t* hash)
+{
+    for (size_t i = 0; i < count; ++i) {
+        int m = (int)moves[i];
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+        shuffleMoveSsse3(f, t, m);
+        if (hash) *hash ^= movedFaceletsHash(f, t, m);
+    }
+}
+
+void cpuFeatures(bool& ssse3, bool& avx2)
+{
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    int maxLeaf = r[0];
+    __cpuid(r, 1);
+    ssse3 = (r[2] & (1 << 9)) != 0;
+    // AVX2 also needs the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2)
+    bool ymm = (r[2] & (1 << 27)) && (r[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    avx2 = false;
+    if (ymm && maxLeaf >= 7) {
+        __cpuidex(r, 7, 0);
+        avx2 = (r[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif // FACELET_X86
+
+struct KernelChoice {
+    MoveKernel apply = applyMovesScalar;
+    const char* name = "scalar";
+
+    KernelChoice()
+    {
+#if defined(FACELET_X86)
+        bool ssse3 = false, avx2 = false;
+        cpuFeatures(ssse3, avx2);
+        if (avx2) {
+            apply = applyMovesAvx2;
+            name = "avx2";
+        } else if (ssse3) {
+            apply = applyMovesSsse3;
+            name = "ssse3";
+        }
+#endif
+    }
+};
+
+const KernelChoice& kernel()
+{
+    static const KernelChoice choice;
+    return choice;
+}
+
+} // namespace
+
+FaceletCube::FaceletCube()
+{
+    for (int i = 0; i < 64; ++i) f[i] = i < 54 ? (uint8_t)i : 0;
+}
+
+const char* FaceletCube::kernelName()
+{
+    return kernel().name;
+}
+
+void FaceletCube::applyMove(Move m)
+{
+    kernel().apply(f, shuffleTable(), &m, 1, nullptr);
+}
+
+void FaceletCube::applySequence(const Move* moves, size_t count)
+{
+    kernel().apply(f, shuffleTable(), moves, count, nullptr);
+}
+
+uint64_t FaceletCube::hash() const
+{
+    const ShuffleTable& t = shuffleTable();
+    uint64_t h = 0;
+    for (int p = 0; p < 54; ++p) h ^= t.key[p][f[p] / 9];
+    return h;
+}
+
+void FaceletCube::applyMove(Move m, uint64_t& hash)
+{
+    kernel().apply(f, shuffleTable(), &m, 1, &hash);
+}
+
+void FaceletCube::applySequence(const Move* moves, size_t count, uint64_t& hash)
+{
+    uint64_t h = hash;
+    kernel().apply(f, shuffleTable(), moves, count, &h);
+    hash = h;
+}
+
+bool FaceletCube::operator==(const FaceletCube& o) const
+{
+    // SSE2 is part of every x86-64 target, so this needs no dispatch
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    __m128i eq = _mm_set1_epi8(-1);
+    for (int j = 0; j < 4; ++j)
+        eq = _mm_and_si128(eq, _mm_cmpeq_epi8(_mm_load_si128((const __m128i*)(f + 16 * j)), _mm_load_si128((const __m128i*)(o.f + 16 * j))));
+    return _mm_movemask_epi8(eq) == 0xFFFF;
+#else
+    return memcmp(f, o.f, 64) == 0;
+#endif
+}
+
+bool FaceletCube::isSolved() const
+{
+    static const FaceletCube solved;
+    return *this == solved;
+}
+
+void FaceletCube::toFaceIds(uint8_t faceIds[54]) const
+{
+    for (int i = 0; i < 54; ++i) faceIds[i] = f[i] / 9;
+}
+
+FaceletCube FaceletCube::fromCubie(const CubieCube& c)
+{
+    FaceletCube r;
+    c.toFaceletPermutation(r.f);
+    return r;
+}
+
+bool FaceletCube::toCubie(CubieCube& out) const
+{
+    uint8_t faceIds[54];
+    toFaceIds(faceIds);
+    return CubieCube::fromFacelets(faceIds, out);
+}
@@ -0,0 +1,53 @@
+#ifndef FACELET_H
+#define FACELET_H
+
+// FaceletCube - packed 3x3 facelet state for bulk verification and fast comparison
+// - 54 facelets as bytes (padded to 64, i.e. two 32-byte registers), in Core's sticker order
+//   (U,R,F,D,L,B x 9 as built by buildInitialStickers())
+// - f[i] = which facelet (0..53, equivalently which Core sticker) currently sits at position i;
+//   the color shown there is f[i] / 9
+// - Each of the 18 moves is a precomputed byte shuffle: AVX2 or SSSE3 pshufb on x86, chosen
+//   once at run time from the CPU (no -mavx2 / /arch needed), a plain gather loop otherwise
+// - Equality is a few SSE2 compares
+// Usage:
+//   FaceletCube c;                       // solved
+//   c.applySequence(moves.data(), moves.size());
+//   if (c.isSolved()) ...
+//
+// No GL and no GLM here.
+
+#include <cstdint>
+#include <cstddef>
+#include "move.h"
+
+struct CubieCube;
+
+struct alignas(32) FaceletCube {
+    uint8_t f[64]; // f[54..63] is padding and always zero
+
+    FaceletCube(); // solved
+
+    void applyMove(Move m);
+    void applySequence(const Move* moves, size_t count);
+    // The shuffle kernel in use: "avx2", "ssse3" or "scalar".
+    static const char* kernelName();
+
+    // Zobrist hash of the colors (zobrist.h), equal to CubieCube::hash() for the same state.
+    // The overloads below keep a caller-held hash current from the 20 facelets a move moves.
+    uint64_t hash() const;
+    void applyMove(Move m, uint64_t& hash);
+    void applySequence(const Move* moves, size_t count, uint64_t& hash);
+
+    bool isSolved() const;
+    bool operator==(const FaceletCube& o) const;
+    bool operator!=(const FaceletCube& o) const { return !(*this == o); }
+
+    // faceIds[i] = face (0..5, U R F D L B) whose color shows at position i
+    void toFaceIds(uint8_t faceIds[54]) const;
+
+    static FaceletCube fromCubie(const CubieCube& c);
+    // returns false if the facelets don't describe a reachable cube
+    bool toCubie(CubieCube& out) const;
+};
+
+#endif // FACELET_H
@@ -0,0 +1,242 @@
+#include "frame_profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Chrome trace thread ids
+const int TRACK_CPU = 1;
+const int TRACK_GPU = 2;
+
+// nearest-rank percentiles of v (reordered)
+Percentiles percentiles(std::vector<float>& v)
+{
+    Percentiles p;
+    if (v.empty()) return p;
+    auto rank = [&](double q) {
+        size_t k = (size_t)std::ceil(q * v.size());
+        k = std::min(std::max(k, (size_t)1), v.size()) - 1;
+        std::nth_element(v.begin(), v.begin() + k, v.end());
+        return (double)v[k];
+    };
+    p.p50 = rank(0.50);
+    p.p99 = rank(0.99);
+    p.max = *std::max_element(v.begin(), v.end());
+    return p;
+}
+
+} // namespace
+
+FrameProfiler::FrameProfiler(size_t window)
+    : m_origin(std::chrono::steady_clock::now()),
+      m_frames(std::max(window, (size_t)(4 * kGpuLatencyFrames)))
+{
+}
+
+FrameProfiler::~FrameProfiler()
+{
+    close();
+}
+
+int FrameProfiler::addSection(const std::string& name)
+{
+    if ((int)m_names.size() >= kMaxSections) return -1;
+    m_names.push_back(name);
+    return (int)m_names.size() - 1;
+}
+
+int FrameProfiler::sectionCount() const
+{
+    return (int)m_names.size();
+}
+
+const std::string& FrameProfiler::sectionName(int id) const
+{
+    return m_names[id];
+}
+
+double FrameProfiler::nowUs() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_origin).count();
+}
+
+void FrameProfiler::beginSection(int section)
+{
+    if (section < 0 || section >= (int)m_names.size()) return;
+    m_sectionStartUs[section] = nowUs();
+}
+
+void FrameProfiler::endSection(int section)
+{
+    if (section < 0 || section >= (int)m_names.size()) return;
+    double end = nowUs(), start = m_sectionStartUs[section];
+    m_current.sectionMs[section] += (float)((end - start) / 1000.0);
+    if (m_trace.is_open()) traceEvent(m_names[section].c_str(), TRACK_CPU, start, end - start);
+}
+
+FrameProfiler::Frame& FrameProfiler::slot(uint64_t frame)
+{
+    return m_frames[frame % m_frames.size()];
+}
+
+void FrameProfiler::beginFrame()
+{
+    double now = nowUs();
+    if (m_inFrame) finishFrame(now);
+    m_inFrame = true;
+    m_current = Frame();
+    m_current.index = ++m_index;
+    m_current.startUs = now;
+}
+
+void FrameProfiler::endFrame()
+{
+    if (!m_inFrame) return;
+    finishFrame(nowUs());
+    m_inFrame = false;
+}
+
+void FrameProfiler::finishFrame(double endUs)
+{
+    m_current.frameMs = (float)((endUs - m_current.startUs) / 1000.0);
+    slot(m_current.index) = m_current;
+    if (m_trace.is_open()) {
+        traceEvent("frame", TRACK_CPU, m_current.startUs, endUs - m_current.startUs);
+        traceCounters(m_current);
+    }
+    if (m_csv.is_open()) {
+        // wait a few frames for the GPU time before giving up on it
+        while (m_csvNext <= m_current.index &&
+               (slot(m_csvNext).gpuMs >= 0.0f || m_csvNext + kGpuLatencyFrames <= m_current.index))
+            writeCsvRow(slot(m_csvNext++));
+    }
+}
+
+uint64_t FrameProfiler::frameIndex() const
+{
+    return m_index;
+}
+
+void FrameProfiler::addGpuTime(uint64_t frame, double ms)
+{
+    Frame* f = nullptr;
+    uint64_t finished = m_inFrame ? m_index - 1 : m_index;
+    if (frame == m_index && m_inFrame) {
+        f = &m_current;
+    } else if (frame >= 1 && frame <= finished && m_index - frame <= (uint64_t)kGpuLatencyFrames) {
+        f = &slot(frame);
+    }
+    if (!f || f->index != frame) return;
+    f->gpuMs = (float)ms;
+    // only the duration is measured, so the event starts with its frame
+    if (m_trace.is_open()) traceEvent("draw (GPU)", TRACK_GPU, f->startUs, ms * 1000.0);
+}
+
+void FrameProfiler::setCounters(uint64_t landedTurns, size_t queueDepth)
+{
+    m_current.landedTurns = landedTurns;
+    m_current.queueDepth = (uint32_t)std::min(queueDepth, (size_t)UINT32_MAX);
+}
+
+FrameStats FrameProfiler::stats() const
+{
+    FrameStats s;
+    uint64_t finished = m_inFrame ? m_index - 1 : m_index;
+    s.frames = (size_t)std::min<uint64_t>(finished, m_frames.size());
+    s.sectionMs.resize(m_names.size());
+    if (s.frames == 0) return s;
+
+    std::vector<float> frame, gpu, depth, section[kMaxSections];
+    uint64_t first = finished - s.frames + 1;
+    for (uint64_t i = first; i <= finished; ++i) {
+        const Frame& f = m_frames[i % m_frames.size()];
+        frame.push_back(f.frameMs);
+        if (f.gpuMs >= 0.0f) gpu.push_back(f.gpuMs);
+        depth.push_back((float)f.queueDepth);
+        for (size_t k = 0; k < m_names.size(); ++k) section[k].push_back(f.sectionMs[k]);
+    }
+    s.frameMs = percentiles(frame);
+    s.gpuFrames = gpu.size();
+    s.gpuMs = percentiles(gpu);
+    s.queueDepth = percentiles(depth);
+    for (size_t k = 0; k < m_names.size(); ++k) s.sectionMs[k] = percentiles(section[k]);
+
+    // turns landed between the end of the oldest frame and the end of the newest
+    const Frame& a = m_frames[first % m_frames.size()];
+    const Frame& b = m_frames[finished % m_frames.size()];
+    double spanUs = (b.startUs + b.frameMs * 1000.0) - (a.startUs + a.frameMs * 1000.0);
+    if (spanUs > 0.0 && b.landedTurns >= a.landedTurns)
+        s.movesPerSecond = (double)(b.landedTurns - a.landedTurns) * 1e6 / spanUs;
+    return s;
+}
+
+size_t FrameProfiler::recentFrameTimes(float* outMs, size_t max) const
+{
+    uint64_t finished = m_inFrame ? m_index - 1 : m_index;
+    size_t n = (size_t)std::min<uint64_t>(std::min<uint64_t>(finished, m_frames.size()), max);
+    for (size_t i = 0; i < n; ++i) outMs[i] = m_frames[(finished - n + 1 + i) % m_frames.size()].frameMs;
+    return n;
+}
+
+bool FrameProfiler::openCsv(const std::string& path)
+{
+    m_csv.close();
+    m_csv.open(path, std::ios::out | std::ios::trunc);
+    if (!m_csv) return false;
+    m_csv << "frame,start_ms,frame_ms";
+    for (const std::string& name : m_names) m_csv << ',' << name << "_ms";
+    m_csv << ",gpu_ms,queue_depth,landed_turns\n";
+    m_csvNext = m_index + 1; // rows begin with the next finished frame
+    return true;
+}
+
+bool FrameProfiler::openTrace(const std::string& path)
+{
+    m_trace.close();
+    m_trace.open(path, std::ios::out | std::ios::trunc);
+    if (!m_trace) return false;
+    m_trace << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << TRACK_CPU
+            << ",\"args\":{\"name\":\"CPU frame\"}},\n"
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << TRACK_GPU
+            << ",\"args\":{\"name\":\"GPU draw\"}}";
+    return true;
+}
+
+void FrameProfiler::close()
+{
+    if (m_csv.is_open()) {
+        uint64_t finished = m_inFrame ? m_index - 1 : m_index;
+        while (m_csvNext <= finished) writeCsvRow(slot(m_csvNext++));
+        m_csv.close();
+    }
+    if (m_trace.is_open()) {
+        m_trace << "\n]}\n";
+        m_trace.close();
+    }
+}
+
+void FrameProfiler::writeCsvRow(const Frame& f)
+{
+    m_csv << f.index << ',' << f.startUs / 1000.0 << ',' << f.frameMs;
+    for (size_t k = 0; k < m_names.size(); ++k) m_csv << ',' << f.sectionMs[k];
+    m_csv << ',';
+    if (f.gpuMs >= 0.0f) m_csv << f.gpuMs;
+    m_csv << ',' << f.queueDepth << ',' << f.landedTurns << '\n';
+}
+
+void FrameProfiler::traceEvent(const char* name, int track, double startUs, double durUs)
+{
+    // every trace starts with the track names, so each event follows a comma
+    m_trace << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track
+            << ",\"ts\":" << (uint64_t)startUs << ",\"dur\":" << (uint64_t)std::max(durUs, 0.0) << '}';
+}
+
+void FrameProfiler::traceCounters(const Frame& f)
+{
+    m_trace << ",\n{\"name\":\"queue depth\",\"ph\":\"C\",\"pid\":1,\"ts\":" << (uint64_t)f.startUs
+            << ",\"args\":{\"moves\":" << f.queueDepth << "}},\n"
+            << "{\"name\":\"landed turns\",\"ph\":\"C\",\"pid\":1,\"ts\":" << (uint64_t)f.startUs
+            << ",\"args\":{\"turns\":" << f.landedTurns << "}}";
+}
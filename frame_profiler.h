@@ -0,0 +1,139 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+// FrameProfiler - per-frame CPU section timers, GPU times and counters, with rolling percentiles
+// - addSection() names up to kMaxSections parts of the frame; a Scope (or begin/endSection)
+//   adds its steady_clock time to the current frame's section (a section may run several
+//   times per frame)
+// - beginFrame() closes the previous frame: its time runs start to start, so swap and vsync
+//   waits count against it; endFrame() closes it early instead when the loop goes idle
+// - GPU times arrive a frame or two late (GpuTimer); addGpuTime() files them under the frame
+//   that was measured
+// - stats() reports p50/p99/max over the last `window` frames for the frame time, every
+//   section and the GPU time, the queue depth, and moves/sec over the same window
+// - Optional streams: a CSV row per frame (written once its GPU time is in, or given up on)
+//   and a Chrome trace (chrome://tracing, Perfetto) with one event per scope, the GPU draw on
+//   its own track, and counter tracks for queue depth and moves landed
+// - Render thread only
+// Usage:
+//   FrameProfiler prof;
+//   int update = prof.addSection("update");
+//   prof.openTrace("frames.json");
+//   // each frame:
+//   prof.beginFrame();
+//   { FrameProfiler::Scope s(prof, update); core.update(dt); }
+//   prof.setCounters(core.landedTurnCount(), core.queuedMoveCount());
+//   FrameStats st = prof.stats();  // st.frameMs.p99 ...
+//
+// No GL here.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Percentiles {
+    double p50 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+struct FrameStats {
+    size_t frames = 0;                 // frames in the window
+    Percentiles frameMs;
+    std::vector<Percentiles> sectionMs; // by section id
+    Percentiles gpuMs;                 // frames with a GPU time only
+    size_t gpuFrames = 0;
+    Percentiles queueDepth;
+    double movesPerSecond = 0.0;       // turns landed per second over the window
+};
+
+class FrameProfiler {
+public:
+    static const int kMaxSections = 8;
+    // GPU times later than this many frames are dropped (the CSV row is written without one)
+    static const int kGpuLatencyFrames = 4;
+
+    explicit FrameProfiler(size_t window = 600);
+    ~FrameProfiler();
+
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    // Returns the section id, or -1 once kMaxSections are in use. `name` is copied.
+    int addSection(const std::string& name);
+    int sectionCount() const;
+    const std::string& sectionName(int id) const;
+
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, int section) : m_profiler(profiler), m_section(section)
+        {
+            m_profiler.beginSection(m_section);
+        }
+        ~Scope() { m_profiler.endSection(m_section); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler& m_profiler;
+        int m_section;
+    };
+    void beginSection(int section);
+    void endSection(int section);
+
+    void beginFrame();
+    // Close the current frame early, before the loop blocks (on-demand rendering waiting for
+    // events), so the wait is not counted as frame time. Optional; beginFrame() closes it too.
+    void endFrame();
+    uint64_t frameIndex() const; // of the current frame (0 before the first beginFrame())
+    // GPU time of frame `frame` (a frameIndex() seen earlier)
+    void addGpuTime(uint64_t frame, double ms);
+    // turns landed so far (e.g. Core::landedTurnCount()) and the current queue depth
+    void setCounters(uint64_t landedTurns, size_t queueDepth);
+
+    FrameStats stats() const;
+    // Frame times of the last (up to) `max` finished frames, oldest first. Returns the count.
+    size_t recentFrameTimes(float* outMs, size_t max) const;
+
+    // Start streaming to `path` (truncated). False if it can't be created.
+    bool openCsv(const std::string& path);
+    bool openTrace(const std::string& path);
+    // Write out pending rows and terminate the trace (also done by the destructor).
+    void close();
+
+private:
+    struct Frame {
+        uint64_t index = 0;
+        double startUs = 0.0;           // since the profiler was created
+        float frameMs = 0.0f;
+        float sectionMs[kMaxSections] = {};
+        float gpuMs = -1.0f;            // < 0: none (yet)
+        uint64_t landedTurns = 0;
+        uint32_t queueDepth = 0;
+    };
+
+    double nowUs() const;
+    Frame& slot(uint64_t frame);
+    void finishFrame(double endUs);
+    void writeCsvRow(const Frame& f);
+    void traceEvent(const char* name, int track, double startUs, double durUs);
+    void traceCounters(const Frame& f);
+
+    std::chrono::steady_clock::time_point m_origin;
+    std::vector<std::string> m_names;
+    std::vector<Frame> m_frames;        // ring of the last `window` frames, by index % size
+    uint64_t m_index = 0;               // current frame
+    bool m_inFrame = false;
+    double m_sectionStartUs[kMaxSections] = {};
+    Frame m_current;
+
+    std::ofstream m_csv;
+    uint64_t m_csvNext = 1;             // oldest frame whose row is not written yet
+    std::ofstream m_trace;
+};
+
+#endif // FRAME_PROFILER_H
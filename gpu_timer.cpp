@@ -0,0 +1,57 @@
+#include "gpu_timer.h"
+
+bool GpuTimer::create()
+{
+    destroy();
+    glGenQueries(SLOTS, m_queries);
+    return m_queries[0] != 0;
+}
+
+void GpuTimer::destroy()
+{
+    if (m_queries[0]) glDeleteQueries(SLOTS, m_queries);
+    for (int i = 0; i < SLOTS; ++i) {
+        m_queries[i] = 0;
+        m_pending[i] = false;
+    }
+    m_next = 0;
+    m_active = -1;
+}
+
+bool GpuTimer::begin(uint64_t frame)
+{
+    if (!m_queries[0] || m_active >= 0 || m_pending[m_next]) return false;
+    m_active = m_next;
+    m_frames[m_active] = frame;
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_active]);
+    return true;
+}
+
+void GpuTimer::end()
+{
+    if (m_active < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    m_pending[m_active] = true;
+    m_next = (m_active + 1) % SLOTS;
+    m_active = -1;
+}
+
+bool GpuTimer::collect(uint64_t& frame, double& ms)
+{
+    // slots finish in the order they were issued: the oldest pending one is m_next's, unless
+    // that one is free, then the other
+    for (int k = 0; k < SLOTS; ++k) {
+        int slot = (m_next + k) % SLOTS;
+        if (!m_pending[slot]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &ns);
+        m_pending[slot] = false;
+        frame = m_frames[slot];
+        ms = ns / 1e6;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,50 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+// GpuTimer - GL_TIME_ELAPSED queries around a pass, read back without stalling
+// - Double-buffered: two query objects used on alternate frames, so the result read is from
+//   a frame ago and the pipeline keeps running
+// - collect() only reads a query whose GL_QUERY_RESULT_AVAILABLE is set; a frame whose slot is
+//   still pending is not measured rather than waited for
+// - Needs GL 3.3 (timer queries are core there); one begin()/end() pair per frame, not nested
+//   with other GL_TIME_ELAPSED queries
+// Usage:
+//   GpuTimer gpu;
+//   gpu.create();
+//   // each frame:
+//   gpu.begin(frame); draw(); gpu.end();
+//   uint64_t measured; double ms;
+//   while (gpu.collect(measured, ms)) profiler.addGpuTime(measured, ms);
+
+#include <glad/glad.h>
+#include <cstdint>
+
+class GpuTimer {
+public:
+    static const int SLOTS = 2;
+
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    bool create();
+    // Needs the GL context that created the queries to be current.
+    void destroy();
+
+    // Time the GL commands until end() as frame `frame`. Returns false (and end() does
+    // nothing) when the next slot has not been read back yet.
+    bool begin(uint64_t frame);
+    void end();
+
+    // The oldest finished measurement, if any: which frame and how long the GPU took.
+    bool collect(uint64_t& frame, double& ms);
+
+private:
+    GLuint m_queries[SLOTS] = {};
+    uint64_t m_frames[SLOTS] = {};
+    bool m_pending[SLOTS] = {};
+    int m_next = 0;     // slot the next begin() uses
+    int m_active = -1;  // slot between begin() and end()
+};
+
+#endif // GPU_TIMER_H
@@ -8,9 +8,16 @@
 
   Notes:
   - core.h/core.cpp must be in same directory (or adjust includes).
-  - This example uses simple per-sticker draw calls (no instancing) for clarity.
+  - All stickers are drawn with a single instanced draw call: the quad VAO is shared and
+    each instance reads its 4-byte PackedSticker (lattice position, face, color id) from a
+    per-instance attribute buffer; the vertex shader rebuilds the model matrix from a few
+    uniforms (Core::stickerGeometry()) and looks the color up in Core::colorPalette().
   - Press keys U D L R F B to queue face turns.
     Hold SHIFT to make the move a prime (counter-clockwise). Hold CTRL to make it a double (2).
+  - F3 toggles the frame statistics overlay (FrameProfiler / StatsOverlay); --profile-csv and
+    --profile-trace stream the same timings to a CSV file and a Chrome trace.
+  - --on-demand draws only while something changes: an idle cube blocks in glfwWaitEvents()
+    until input, a submitted move or a new simulation snapshot wakes it.
 */
 
 #include <glad/glad.h>
@@ -23,23 +30,59 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <random>
 
 #include "core.h"
+#include "sim_thread.h"
+#include "stream_buffer.h"
+#include "scene_renderer.h"
+#include "frame_profiler.h"
+#include "gpu_timer.h"
+#include "stats_overlay.h"
 
 // Simple shader sources embedded here for convenience
 static const char* vertexShaderSrc = R"glsl(
 #version 330 core
 layout(location = 0) in vec3 aPos;
+layout(location = 1) in ivec4 aSticker; // per-instance PackedSticker: doubled lattice position, face | color << 3
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform vec3 uColor; // passed through for flat shading
+
+// Core::stickerGeometry() / colorPalette(), set once
+uniform mat4 uOrientation[6];
+uniform vec3 uFaceNormal[6];
+uniform float uHalfSpacing;
+uniform float uSurfaceOffset;
+uniform vec3 uPalette[6];
+uniform int uCubeSize;
+
+// turning layers; concurrent turns share uAnimAxis and their layer ranges never overlap
+const int MAX_ANIMS = 8; // Core::kMaxActiveTurns
+uniform int uAnimCount;
+uniform vec3 uAnimAxis;
+uniform vec2 uAnimLayers[MAX_ANIMS]; // first, last layer along uAnimAxis (wide turns span several)
+uniform mat4 uLayerModels[MAX_ANIMS];
 
 out vec3 vColor;
 
 void main() {
-    vColor = uColor;
+    int face = aSticker.w & 7;
+    vColor = uPalette[aSticker.w >> 3];
+    vec3 pos = vec3(aSticker.xyz);
+    mat4 rest = uOrientation[face];
+    rest[3] = vec4(pos * uHalfSpacing + uFaceNormal[face] * uSurfaceOffset, 1.0);
+
+    // the doubled coordinate along the axis is 2 * layer - (size - 1)
+    mat4 model = rest;
+    float layer = 0.5 * (dot(pos, uAnimAxis) + float(uCubeSize - 1));
+    for (int i = 0; i < uAnimCount; ++i) {
+        if (layer > uAnimLayers[i].x - 0.5 && layer < uAnimLayers[i].y + 0.5) model = uLayerModels[i] * rest;
+    }
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
 )glsl";
@@ -124,7 +167,47 @@ GLuint createQuadVAO() {
     return vao;
 }
 
+// point the per-instance attribute of the quad VAO at PackedStickers starting at byteOffset in vbo.
+// Location 1 reads the four bytes as an integer vector and advances once per instance.
+void bindInstanceAttributes(GLuint vao, GLuint vbo, size_t byteOffset) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 4, GL_BYTE, sizeof(PackedSticker), (void*)byteOffset);
+    glVertexAttribDivisor(1, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// create the per-instance buffer (one PackedSticker per sticker) and hook it into the quad VAO.
+GLuint createInstanceVBO(GLuint vao, size_t maxInstances) {
+    GLuint vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(PackedSticker), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    bindInstanceAttributes(vao, vbo, 0);
+    return vbo;
+}
+
+// the uniforms that turn a PackedSticker into its resting transform and color; fixed per Core
+void setStickerUniforms(GLuint program, const Core& core) {
+    const StickerGeometry& g = core.stickerGeometry();
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "uOrientation"), 6, GL_FALSE, &g.orientation[0][0][0]);
+    glUniform3fv(glGetUniformLocation(program, "uFaceNormal"), 6, &g.normal[0][0]);
+    glUniform1f(glGetUniformLocation(program, "uHalfSpacing"), g.halfSpacing);
+    glUniform1f(glGetUniformLocation(program, "uSurfaceOffset"), g.surfaceOffset);
+    glUniform3fv(glGetUniformLocation(program, "uPalette"), 6, &Core::colorPalette()[0][0]);
+    glUniform1i(glGetUniformLocation(program, "uCubeSize"), core.size());
+    glUseProgram(0);
+}
+
 // Key callback to map UDLRFB keys to cube moves and queue them into Core stored in window user pointer.
+// Moves go through Core's thread-safe submission path so this works whether Core is updated
+// on this thread or on a SimulationThread.
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (action != GLFW_PRESS) return;
     Core* core = reinterpret_cast<Core*>(glfwGetWindowUserPointer(window));
@@ -139,7 +222,7 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         move.push_back(face);
         if (dbl) move.push_back('2');
         if (prime && !dbl) move.push_back('\''); // "R2'" is unusual; we only do R' when shift + not ctrl
-        core->queueMove(move);
+        core->submitMove(move);
         std::cout << "Queued move: " << move << std::endl;
         };
 
@@ -150,13 +233,90 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     case GLFW_KEY_R: push('R'); break;
     case GLFW_KEY_F: push('F'); break;
     case GLFW_KEY_B: push('B'); break;
-    case GLFW_KEY_SPACE: core->clearQueue(); break;
+    case GLFW_KEY_SPACE: core->submitClearQueue(); break;
     case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
     default: break;
     }
 }
 
-int main() {
+// --scene demo: `count` cubes on a grid, each kept busy with random moves, all drawn by
+// SceneRenderer (frustum culled, one multi-draw). Keys drive cube 0.
+static int runSceneDemo(GLFWwindow* window, int count, int cubeSize) {
+    SceneRenderer renderer;
+    if (!renderer.create()) return 1;
+    // per-cube animation and transform export run on every core
+    TaskPool pool;
+    renderer.setTaskPool(&pool);
+    std::cout << "Scene: " << pool.workerCount() << " simulation workers\n";
+    std::cout << (renderer.usesIndirectDraw() ? "Scene: one glMultiDrawArraysIndirect per frame\n"
+                                              : "Scene: one instanced draw per run of visible cubes\n");
+
+    CubeScene scene;
+    int side = std::max(1, (int)std::ceil(std::cbrt((double)count)));
+    float pitch = cubeSize * 1.6f;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 cell((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+        glm::vec3 pos = (cell - 0.5f * (side - 1)) * pitch;
+        scene.addCube(glm::translate(glm::mat4(1.0f), pos), cubeSize, 0.9f, 0.03f, 360.0f);
+    }
+    glfwSetWindowUserPointer(window, &scene.cube(0));
+
+    std::mt19937 rng(1);
+    float extent = side * pitch;
+    glm::vec3 camPos = glm::vec3(0.9f, 0.7f, 1.3f) * extent;
+    glm::mat4 view = glm::lookAt(camPos, glm::vec3(0.0f), glm::vec3(0, 1, 0));
+    double lastTime = glfwGetTime();
+
+    while (!glfwWindowShouldClose(window)) {
+        double now = glfwGetTime();
+        float dt = float(now - lastTime);
+        lastTime = now;
+
+        for (size_t id = 1; id < scene.cubeCount(); ++id) {
+            Core& c = scene.cube(id);
+            if (!c.isAnimating() && c.queuedMoveCount() == 0) c.queueMove((Move)(rng() % kMoveCount));
+        }
+        scene.update(dt, &pool);
+
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        glViewport(0, 0, width, height);
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), width / float(std::max(height, 1)), 0.1f, 4.0f * extent);
+
+        glClearColor(0.12f, 0.12f, 0.12f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.draw(scene, view, projection);
+        glUseProgram(0);
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glfwSetWindowUserPointer(window, nullptr);
+    renderer.destroy();
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --sim-thread: run Core at a fixed timestep on its own thread and render its snapshots
+    // --size N: simulate an NxN cube (Core::kMinSize..Core::kMaxSize, default 3)
+    // --scene COUNT: draw COUNT cubes at once through the scene renderer
+    // --profile-csv PATH / --profile-trace PATH: write per-frame timings (CSV) or a Chrome trace
+    // --on-demand: stop rendering while the cube is idle and wait for events instead
+    bool useSimThread = false;
+    bool onDemand = false;
+    int cubeSize = 3;
+    int sceneCubes = 0;
+    std::string profileCsv, profileTrace;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--sim-thread") useSimThread = true;
+        else if (std::string(argv[i]) == "--on-demand") onDemand = true;
+        else if (std::string(argv[i]) == "--size" && i + 1 < argc) cubeSize = std::atoi(argv[++i]);
+        else if (std::string(argv[i]) == "--scene" && i + 1 < argc) sceneCubes = std::atoi(argv[++i]);
+        else if (std::string(argv[i]) == "--profile-csv" && i + 1 < argc) profileCsv = argv[++i];
+        else if (std::string(argv[i]) == "--profile-trace" && i + 1 < argc) profileTrace = argv[++i];
+    }
+
     if (!glfwInit()) {
         std::cerr << "GLFW init failed\n";
         return 1;
@@ -179,28 +339,90 @@ int main() {
     }
 
     glEnable(GL_DEPTH_TEST);
+    glfwSetKeyCallback(window, keyCallback);
+
+    if (sceneCubes > 0) {
+        int rc = runSceneDemo(window, sceneCubes, cubeSize);
+        glfwTerminate();
+        return rc;
+    }
 
     GLuint program = compileProgram(vertexShaderSrc, fragmentShaderSrc);
     if (!program) return 1;
     GLuint vao = createQuadVAO();
 
     // create Core simulation instance and attach to window for callbacks
-    Core core(0.9f /*cubieSize*/, 0.03f /*gap*/, 720.0f /*deg/sec, fast*/);
+    Core core(0.9f /*cubieSize*/, 0.03f /*gap*/, 720.0f /*deg/sec, fast*/, cubeSize);
     glfwSetWindowUserPointer(window, &core);
-    glfwSetKeyCallback(window, keyCallback);
+    core.setQueueSimplification(true); // quick key bursts (R R R) animate as one turn (R')
+    core.setConcurrentTurns(true);     // and U D turn both layers at once
+    Core::BacklogPolicy backlog;       // held keys / pasted input never lag more than ~1 s
+    backlog.enabled = true;
+    core.setBacklogPolicy(backlog);
+
+    // per-instance data (4 bytes per sticker) lives in one buffer sized once; Core writes
+    // into it directly
+    GLuint instanceVbo = createInstanceVBO(vao, core.stickerCount());
+    std::vector<PackedSticker> instances(core.stickerCount());
+    setStickerUniforms(program, core);
+
+    // preferred: persistently mapped triple-buffered stream that Core writes into directly;
+    // falls back to glBufferSubData from `instances` when GL_ARB_buffer_storage is missing
+    StreamBuffer instanceStream;
+    if (instanceStream.create(GL_ARRAY_BUFFER, core.stickerCount() * sizeof(PackedSticker))) {
+        std::cout << "Streaming instance data through a persistent mapped buffer\n";
+    }
+    static_assert(Core::kMaxActiveTurns == 8, "keep MAX_ANIMS in the vertex shader in sync");
+    Core::LayerAnimation anims[Core::kMaxActiveTurns];
+    glm::vec3 animAxis(0.0f);
+    glm::vec2 animLayers[Core::kMaxActiveTurns];
+    glm::mat4 layerModels[Core::kMaxActiveTurns];
+    int animCount = 0;
+    size_t instanceCount = 0;
+    uint64_t uploadedGeneration = ~0ull; // force the first upload
+
+    SimulationThread sim(core, 240.0);
+    if (onDemand) {
+        // anything that gives an idle loop work posts an empty event to end its wait:
+        // moves submitted from any thread, and (with --sim-thread) every new snapshot
+        core.setSubmitWakeup([](void*) { glfwPostEmptyEvent(); }, nullptr);
+        sim.setPublishWakeup([](void*) { glfwPostEmptyEvent(); }, nullptr);
+    }
+    if (useSimThread) sim.start();
 
     // uniform locations
-    GLint locModel = glGetUniformLocation(program, "model");
     GLint locView = glGetUniformLocation(program, "view");
     GLint locProj = glGetUniformLocation(program, "projection");
-    GLint locColor = glGetUniformLocation(program, "uColor");
+    GLint locAnimCount = glGetUniformLocation(program, "uAnimCount");
+    GLint locAnimAxis = glGetUniformLocation(program, "uAnimAxis");
+    GLint locAnimLayers = glGetUniformLocation(program, "uAnimLayers");
+    GLint locLayerModels = glGetUniformLocation(program, "uLayerModels");
 
     // camera setup
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
-    glm::vec3 camPos(4.0f, 4.0f, 6.0f);
+    float farPlane = 100.0f * std::max(1.0f, core.size() / 3.0f);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, farPlane);
+    // pull back in proportion to the cube so bigger sizes still fit the view
+    glm::vec3 camPos = glm::vec3(4.0f, 4.0f, 6.0f) * (core.size() / 3.0f);
     glm::vec3 camTarget(0.0f, 0.0f, 0.0f);
     glm::mat4 view = glm::lookAt(camPos, camTarget, glm::vec3(0, 1, 0));
 
+    // frame instrumentation: CPU sections, the GPU time of the draw pass, and the overlay.
+    // With --sim-thread, "update" is the snapshot fetch (the simulation runs elsewhere).
+    FrameProfiler profiler;
+    const int secUpdate = profiler.addSection("update");
+    const int secExport = profiler.addSection("export");
+    const int secUpload = profiler.addSection("upload");
+    const int secDraw = profiler.addSection("draw");
+    if (!profileCsv.empty() && !profiler.openCsv(profileCsv))
+        std::cerr << "Can't write " << profileCsv << "\n";
+    if (!profileTrace.empty() && !profiler.openTrace(profileTrace))
+        std::cerr << "Can't write " << profileTrace << "\n";
+    GpuTimer gpuTimer;
+    gpuTimer.create();
+    StatsOverlay overlay;
+    if (!overlay.create()) overlay.setVisible(false);
+    bool overlayKeyDown = false;
+
     // time tracking
     double lastTime = glfwGetTime();
 
@@ -209,46 +431,128 @@ int main() {
         double now = glfwGetTime();
         float dt = float(now - lastTime);
         lastTime = now;
+        profiler.beginFrame();
+
+        // resting stickers only change when a move lands; the turning layers are animated
+        // in the vertex shader from a few uniforms
+        bool uploadNeeded = false;
+        profiler.beginSection(secUpdate);
+        if (useSimThread) {
+            // take the newest published snapshot; the simulation never waits for us
+            sim.fetchSnapshot();
+            const StickerSnapshot& snap = sim.snapshot();
+            uploadNeeded = snap.restGeneration != uploadedGeneration;
+            animCount = snap.animCount;
+            std::copy(snap.anims, snap.anims + animCount, anims);
+        } else {
+            // update simulation
+            core.update(dt);
+            uploadNeeded = core.restGeneration() != uploadedGeneration;
+            animCount = core.layerAnimationCount();
+            for (int i = 0; i < animCount; ++i) anims[i] = core.layerAnimation(i);
+        }
+        profiler.endSection(secUpdate);
+        // idle: this frame shows the final state and nothing is pending, so the next one
+        // would be identical
+        bool idle;
+        if (useSimThread) {
+            const StickerSnapshot& snap = sim.snapshot();
+            profiler.setCounters(snap.landedTurns, snap.queueDepth);
+            idle = snap.animCount == 0 && snap.queueDepth == 0 && !core.hasPendingSubmissions();
+        } else {
+            profiler.setCounters(core.landedTurnCount(), core.queuedMoveCount());
+            idle = core.isIdle();
+        }
+        for (int i = 0; i < animCount; ++i) {
+            animAxis = anims[i].axis;
+            animLayers[i] = glm::vec2((float)anims[i].layerFirst, (float)anims[i].layerLast);
+            layerModels[i] = anims[i].layerModel;
+        }
 
-        // update simulation
-        core.update(dt);
-
-        // fetch sticker transforms & colors
-        std::vector<glm::mat4> mats = core.getStickerModelMatrices();
-        std::vector<glm::vec3> cols = core.getStickerColors();
-        if (mats.size() != cols.size()) {
-            std::cerr << "Core returned mismatched arrays\n";
-            break;
+        if (uploadNeeded) {
+            FrameProfiler::Scope timeExport(profiler, secExport);
+            // write into the next mapped region when streaming, else into the staging array
+            PackedSticker* dst = instanceStream.mapped()
+                ? (PackedSticker*)instanceStream.beginWrite() : instances.data();
+            if (useSimThread) {
+                const StickerSnapshot& snap = sim.snapshot();
+                instanceCount = std::min(snap.stickers.size(), instances.size());
+                std::copy(snap.stickers.begin(), snap.stickers.begin() + instanceCount, dst);
+                uploadedGeneration = snap.restGeneration;
+            } else {
+                instanceCount = core.writePackedStickers(dst, instances.size());
+                uploadedGeneration = core.restGeneration();
+            }
         }
 
         // render
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         glViewport(0, 0, width, height);
-        projection = glm::perspective(glm::radians(45.0f), width / float(height), 0.1f, 100.0f);
+        projection = glm::perspective(glm::radians(45.0f), width / float(height), 0.1f, farPlane);
 
+        gpuTimer.begin(profiler.frameIndex());
         glClearColor(0.12f, 0.12f, 0.12f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glUseProgram(program);
         glUniformMatrix4fv(locView, 1, GL_FALSE, &view[0][0]);
         glUniformMatrix4fv(locProj, 1, GL_FALSE, &projection[0][0]);
+        glUniform1i(locAnimCount, animCount);
+        glUniform3f(locAnimAxis, animAxis.x, animAxis.y, animAxis.z);
+        if (animCount > 0) {
+            glUniform2fv(locAnimLayers, animCount, &animLayers[0][0]);
+            glUniformMatrix4fv(locLayerModels, animCount, GL_FALSE, &layerModels[0][0][0]);
+        }
 
-        glBindVertexArray(vao);
-        // Draw each sticker: set model and color and draw the quad
-        for (size_t i = 0; i < mats.size(); ++i) {
-            glUniformMatrix4fv(locModel, 1, GL_FALSE, &mats[i][0][0]);
-            glm::vec3 c = cols[i];
-            glUniform3f(locColor, c.r, c.g, c.b);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+        // upload per-instance data (if changed) and draw all stickers in one call
+        if (uploadNeeded) {
+            FrameProfiler::Scope timeUpload(profiler, secUpload);
+            if (instanceStream.mapped()) {
+                bindInstanceAttributes(vao, instanceStream.buffer(), instanceStream.regionOffset());
+            } else {
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(PackedSticker), instances.data());
+            }
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
+
+        profiler.beginSection(secDraw);
+        glBindVertexArray(vao);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)instanceCount);
         glBindVertexArray(0);
+        if (instanceStream.mapped()) instanceStream.fence();
         glUseProgram(0);
+        profiler.endSection(secDraw);
+        gpuTimer.end();
+
+        // results of earlier frames, whichever are ready; never waits on the GPU
+        uint64_t gpuFrame;
+        double gpuMs;
+        while (gpuTimer.collect(gpuFrame, gpuMs)) profiler.addGpuTime(gpuFrame, gpuMs);
+
+        bool overlayKey = glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS;
+        if (overlayKey && !overlayKeyDown) overlay.setVisible(!overlay.visible());
+        overlayKeyDown = overlayKey;
+        overlay.update(profiler, glfwGetTime());
+        overlay.draw(width, height);
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (onDemand && idle) {
+            profiler.endFrame(); // the wait is not frame time
+            glfwWaitEvents();
+            lastTime = glfwGetTime(); // nor simulation time: resume with a normal step
+        } else {
+            glfwPollEvents();
+        }
     }
 
+    sim.stop();
+    profiler.close();
+    overlay.destroy();
+    gpuTimer.destroy();
+    instanceStream.destroy();
+    glDeleteBuffers(1, &instanceVbo);
     glDeleteVertexArrays(1, &vao);
     glDeleteProgram(program);
     glfwTerminate();
@@ -0,0 +1,43 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+// MappedFile - read-only memory mapping of a whole file
+// - POSIX: open + mmap(PROT_READ, MAP_SHARED); Windows: CreateFileMapping + MapViewOfFile
+// - Pages are backed by the file itself, so every process mapping the same file shares them
+//   and nothing is copied on open
+// Usage:
+//   MappedFile f;
+//   if (f.open("tables.bin")) use(f.data(), f.size());
+//
+// No dependencies beyond the platform headers (kept out of this header).
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false (and stays closed) if the file is missing, empty or can't be mapped.
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;    // HANDLE
+    void* m_mapping = nullptr; // HANDLE
+#endif
+};
+
+#endif // MAPPED_FILE_H
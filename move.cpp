@@ -0,0 +1,258 @@
+#include "move.h"
+
+#include <cctype>
+#include <cstring>
+
+static const char* MOVE_NAMES[kMoveCount] = {
+    "U", "U2", "U'", "R", "R2", "R'", "F", "F2", "F'",
+    "D", "D2", "D'", "L", "L2", "L'", "B", "B2", "B'"
+};
+
+const char* moveName(Move m)
+{
+    return MOVE_NAMES[(int)m];
+}
+
+static int faceIndex(char c)
+{
+    switch (toupper((unsigned char)c)) {
+        case 'U': return 0;
+        case 'R': return 1;
+        case 'F': return 2;
+        case 'D': return 3;
+        case 'L': return 4;
+        case 'B': return 5;
+    }
+    return -1;
+}
+
+bool parseMoveToken(const char* text, size_t len, Move& out)
+{
+    // skip whitespace on both ends without building a trimmed copy
+    size_t b = 0, e = len;
+    while (b < e && isspace((unsigned char)text[b])) ++b;
+    while (e > b && isspace((unsigned char)text[e - 1])) --e;
+    if (b == e) return false;
+
+    int face = faceIndex(text[b]);
+    if (face < 0) return false;
+
+    int turns = 1;
+    size_t i = b + 1;
+    if (i < e && text[i] == '2') { turns = 2; ++i; }
+    if (i < e && text[i] == '\'') { turns = (turns == 2) ? 2 : 3; ++i; }
+    if (i != e) return false;
+
+    out = makeMove(face, turns);
+    return true;
+}
+
+bool parseMoveToken(const std::string& token, Move& out)
+{
+    return parseMoveToken(token.data(), token.size(), out);
+}
+
+bool parseMoveSequence(const std::string& text, std::vector<Move>& out)
+{
+    size_t start = out.size();
+    size_t i = 0, n = text.size();
+    while (i < n) {
+        while (i < n && isspace((unsigned char)text[i])) ++i;
+        size_t j = i;
+        while (j < n && !isspace((unsigned char)text[j])) ++j;
+        if (j == i) break;
+        Move m;
+        if (!parseMoveToken(text.data() + i, j - i, m)) {
+            out.resize(start);
+            return false;
+        }
+        out.push_back(m);
+        i = j;
+    }
+    return true;
+}
+
+// per face (U R F D L B): turning axis and whether the face sits on the +axis side
+static const uint8_t FACE_AXIS[6] = { 1, 0, 2, 1, 0, 2 };
+static const bool FACE_POSITIVE[6] = { true, true, true, false, false, false };
+
+// Face turns are clockwise seen from outside, i.e. negative about the outward normal.
+static uint8_t positiveQuarterTurns(int face, int clockwiseTurns)
+{
+    return (uint8_t)(FACE_POSITIVE[face] ? (4 - clockwiseTurns) & 3 : clockwiseTurns);
+}
+
+// Layers depthLo..depthHi (1 = the face itself) counted inward from `face`.
+static LayerTurn faceLayers(int face, int depthLo, int depthHi, int clockwiseTurns, int size)
+{
+    LayerTurn t;
+    t.axis = FACE_AXIS[face];
+    if (FACE_POSITIVE[face]) {
+        t.first = (uint8_t)(size - depthHi);
+        t.last = (uint8_t)(size - depthLo);
+    } else {
+        t.first = (uint8_t)(depthLo - 1);
+        t.last = (uint8_t)(depthHi - 1);
+    }
+    t.quarterTurns = positiveQuarterTurns(face, clockwiseTurns);
+    return t;
+}
+
+LayerTurn layerTurnFromMove(Move m, int size)
+{
+    return faceLayers(moveFace(m), 1, 1, moveQuarterTurns(m), size);
+}
+
+bool isValidLayerTurn(const LayerTurn& t, int size)
+{
+    return t.axis <= 2 && t.first <= t.last && t.last < size && t.quarterTurns >= 1 && t.quarterTurns <= 3;
+}
+
+bool layerTurnToMove(const LayerTurn& t, int size, Move& out)
+{
+    if (t.first != t.last || t.axis > 2 || t.quarterTurns < 1 || t.quarterTurns > 3) return false;
+    int face = -1;
+    for (int f = 0; f < 6; ++f) {
+        if (FACE_AXIS[f] != t.axis) continue;
+        if (FACE_POSITIVE[f] ? t.last == size - 1 : t.first == 0) { face = f; break; }
+    }
+    if (face < 0) return false;
+    // positiveQuarterTurns is its own inverse
+    out = makeMove(face, positiveQuarterTurns(face, t.quarterTurns));
+    return true;
+}
+
+bool parseLayerTurn(const char* text, size_t len, int size, LayerTurn& out)
+{
+    size_t b = 0, e = len;
+    while (b < e && isspace((unsigned char)text[b])) ++b;
+    while (e > b && isspace((unsigned char)text[e - 1])) --e;
+    if (b == e) return false;
+
+    size_t i = b;
+    int prefix = 0;
+    while (i < e && isdigit((unsigned char)text[i]) && prefix <= size) prefix = prefix * 10 + (text[i++] - '0');
+    if (i == e) return false;
+    bool hasPrefix = i > b;
+
+    char c = text[i++];
+    int face = -1, slice = -1;
+    bool wide = false, lower = false;
+    if (strchr("URFDLB", c)) face = faceIndex(c);
+    else if (strchr("urfdlb", c)) {
+        // lowercase is wide from 4x4 up; on smaller cubes it stays the plain face turn, as in
+        // parseMoveToken, so "r" keeps its meaning for 3x3 input
+        face = faceIndex(c);
+        lower = true;
+        wide = size >= 4;
+        if (!wide && hasPrefix) return false;
+    }
+    else if (c == 'M') slice = 4;  // turns like L
+    else if (c == 'E') slice = 3;  // turns like D
+    else if (c == 'S') slice = 2;  // turns like F
+    else return false;
+
+    if (i < e && text[i] == 'w') {
+        if (face < 0 || lower) return false;
+        wide = true;
+        ++i;
+    }
+
+    int turns = 1;
+    if (i < e && text[i] == '2') { turns = 2; ++i; }
+    if (i < e && text[i] == '\'') { turns = (turns == 2) ? 2 : 3; ++i; }
+    if (i != e) return false;
+
+    if (slice >= 0) {
+        if (hasPrefix || size < 3 || size % 2 == 0) return false;
+        int mid = (size + 1) / 2;
+        out = faceLayers(slice, mid, mid, turns, size);
+        return true;
+    }
+
+    int n = hasPrefix ? prefix : (wide ? 2 : 1);
+    if (n < 1 || n > size) return false;
+    out = wide ? faceLayers(face, 1, n, turns, size) : faceLayers(face, n, n, turns, size);
+    return true;
+}
+
+bool parseLayerTurnSequence(const std::string& text, int size, std::vector<LayerTurn>& out)
+{
+    size_t start = out.size();
+    size_t i = 0, n = text.size();
+    while (i < n) {
+        while (i < n && isspace((unsigned char)text[i])) ++i;
+        size_t j = i;
+        while (j < n && !isspace((unsigned char)text[j])) ++j;
+        if (j == i) break;
+        LayerTurn t;
+        if (!parseLayerTurn(text.data() + i, j - i, size, t)) {
+            out.resize(start);
+            return false;
+        }
+        out.push_back(t);
+        i = j;
+    }
+    return true;
+}
+
+std::string formatMoveSequence(const Move* moves, size_t count)
+{
+    std::string s;
+    s.reserve(count * 3);
+    for (size_t i = 0; i < count; ++i) {
+        if (i) s.push_back(' ');
+        s += moveName(moves[i]);
+    }
+    return s;
+}
+
+bool mergeLayerTurn(LayerTurn& into, const LayerTurn& t)
+{
+    if (into.axis != t.axis || into.first != t.first || into.last != t.last) return false;
+    into.quarterTurns = (uint8_t)((into.quarterTurns + t.quarterTurns) & 3);
+    return true;
+}
+
+size_t simplifyLayerTurns(LayerTurn* turns, size_t count)
+{
+    // turns[0..n) is the simplified prefix; it never holds two adjacent runs of one axis,
+    // because turns only cancel out of the last run
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        LayerTurn t = turns[i];
+        if ((t.quarterTurns & 3) == 0) continue;
+        bool merged = false;
+        for (size_t k = n; k > 0 && turns[k - 1].axis == t.axis; --k) {
+            if (!mergeLayerTurn(turns[k - 1], t)) continue;
+            if (turns[k - 1].quarterTurns == 0) {
+                for (size_t j = k; j < n; ++j) turns[j - 1] = turns[j];
+                --n;
+            }
+            merged = true;
+            break;
+        }
+        if (!merged) turns[n++] = t;
+    }
+    return n;
+}
+
+void simplifyLayerTurns(std::vector<LayerTurn>& turns)
+{
+    turns.resize(simplifyLayerTurns(turns.data(), turns.size()));
+}
+
+size_t simplifyMoves(Move* moves, size_t count)
+{
+    // face turns are the outer layer turns of a 3x3, and stay outer turns when merged
+    std::vector<LayerTurn> turns(count);
+    for (size_t i = 0; i < count; ++i) turns[i] = layerTurnFromMove(moves[i], 3);
+    size_t n = simplifyLayerTurns(turns.data(), count);
+    for (size_t i = 0; i < n; ++i) layerTurnToMove(turns[i], 3, moves[i]);
+    return n;
+}
+
+void simplifyMoves(std::vector<Move>& moves)
+{
+    moves.resize(simplifyMoves(moves.data(), moves.size()));
+}
@@ -0,0 +1,99 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+// Move - compact 1-byte face turn code shared by Core and the batch state engines
+// - Standard notation: a turn is clockwise when looking at the face from outside
+// - Encoded as face * 3 + (quarterTurns - 1), faces in Core's sticker order U R F D L B,
+//   so "U" = 0, "U2" = 1, "U'" = 2, "R" = 3, ... "B'" = 17
+//
+// No dependencies beyond the standard library.
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class Move : uint8_t {
+    U, U2, Ui,
+    R, R2, Ri,
+    F, F2, Fi,
+    D, D2, Di,
+    L, L2, Li,
+    B, B2, Bi
+};
+
+static const int kMoveCount = 18;
+
+// face index 0..5 in U R F D L B order
+inline int moveFace(Move m) { return (int)m / 3; }
+// 1, 2 or 3 clockwise quarter turns (3 == prime)
+inline int moveQuarterTurns(Move m) { return (int)m % 3 + 1; }
+// quarterTurns is taken modulo 4 and must not be 0 (mod 4)
+inline Move makeMove(int face, int quarterTurns) { return (Move)(face * 3 + ((quarterTurns & 3) - 1)); }
+inline Move inverseMove(Move m) { return makeMove(moveFace(m), 4 - moveQuarterTurns(m)); }
+
+// "U", "U2", "U'", ...
+const char* moveName(Move m);
+
+// Parse one move token: "U", "U'", "U2", also "u", "R2'" and surrounding whitespace.
+// Returns false if the token is not a face turn.
+bool parseMoveToken(const char* text, size_t len, Move& out);
+bool parseMoveToken(const std::string& token, Move& out);
+
+// Parse a whitespace separated sequence such as "R U R' U'" (appends to out).
+// Returns false (leaving out untouched) on the first invalid token.
+bool parseMoveSequence(const std::string& text, std::vector<Move>& out);
+
+// Format a sequence back to text, space separated.
+std::string formatMoveSequence(const Move* moves, size_t count);
+
+// General layer turn for NxN cubes (what Core queues and animates):
+// layers first..last along `axis` (0 = most negative side) turn by quarterTurns * 90 degrees
+// counter-clockwise about the +axis direction (right-hand rule).
+struct LayerTurn {
+    uint8_t axis = 0;         // 0 = x (R/L), 1 = y (U/D), 2 = z (F/B)
+    uint8_t first = 0;        // lowest layer index, 0..size-1
+    uint8_t last = 0;         // highest layer index, first..size-1
+    uint8_t quarterTurns = 1; // 1..3
+};
+
+inline bool operator==(const LayerTurn& a, const LayerTurn& b)
+{
+    return a.axis == b.axis && a.first == b.first && a.last == b.last && a.quarterTurns == b.quarterTurns;
+}
+inline bool operator!=(const LayerTurn& a, const LayerTurn& b) { return !(a == b); }
+
+// True if t fits a size x size cube: axis 0..2, first <= last < size, 1..3 quarter turns.
+// Every entry point that takes a LayerTurn from outside checks this.
+bool isValidLayerTurn(const LayerTurn& t, int size);
+// The outer-layer turn of a face move on a size x size cube.
+LayerTurn layerTurnFromMove(Move m, int size);
+// Inverse of layerTurnFromMove; false unless t turns exactly one outer layer.
+bool layerTurnToMove(const LayerTurn& t, int size, Move& out);
+
+// Parse one NxN token for a size x size cube (standard notation):
+//   "R" "R'" "R2"     outer face turns
+//   "2R" "3L'"        n-th layer from that face only
+//   "Rw" "3Rw2" "r"   the outer n layers together (n defaults to 2); lowercase means w on
+//                     4x4 and up only, below that "r" is R (as in parseMoveToken)
+//   "M" "E" "S"       middle slice (odd sizes only), turning like L, D and F respectively
+// Returns false if the token is malformed or doesn't fit the cube size.
+bool parseLayerTurn(const char* text, size_t len, int size, LayerTurn& out);
+bool parseLayerTurnSequence(const std::string& text, int size, std::vector<LayerTurn>& out);
+
+// Sequence simplification. Turns about one axis all commute, so inside each run of
+// consecutive same-axis turns, turns of the same layers are added up (mod 4) and dropped when
+// they cancel: "R L R" -> "R2 L", "R R R" -> "R'", "U D' U'" -> "D'", and since a cancelled run
+// lets its neighbours meet, "R U U' R" -> "R2". Kept turns stay in order of first appearance.
+// The result turns the cube exactly like the input.
+
+// Fold `t` into `into` if both turn the same layers; quarter turns become (sum mod 4), 0
+// meaning the pair cancelled. Returns false (nothing changed) for different layers.
+bool mergeLayerTurn(LayerTurn& into, const LayerTurn& t);
+// In place; returns the new count.
+size_t simplifyLayerTurns(LayerTurn* turns, size_t count);
+void simplifyLayerTurns(std::vector<LayerTurn>& turns);
+size_t simplifyMoves(Move* moves, size_t count);
+void simplifyMoves(std::vector<Move>& moves);
+
+#endif // MOVE_H
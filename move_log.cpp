@@ -0,0 +1,473 @@
+#include "move_log.h"
+#include "core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const char LOG_MAGIC[8] = { 'R', 'C', 'M', 'O', 'V', 'L', 'O', 'G' };
+const char INDEX_MAGIC[8] = { 'R', 'C', 'M', 'L', 'I', 'D', 'X', '1' };
+const uint16_t LOG_VERSION = 1;
+const size_t HEADER_BYTES = 16;
+
+// record tags; 0..17 are Move codes
+const uint8_t TAG_LAYER_TURN = 0x20;
+const uint8_t TAG_CHECKPOINT = 0x30;
+const uint8_t TAG_STATE_JUMP = 0x31;
+
+const size_t MAX_VARINT_BYTES = 10;
+const size_t FLUSH_BYTES = 64 * 1024;
+
+void putVarint(std::vector<uint8_t>& out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+void putU64(std::vector<uint8_t>& out, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+uint64_t getU64(const uint8_t* p)
+{
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// Reads a varint from p[0..avail); returns its length, 0 if cut off or overlong.
+size_t getVarint(const uint8_t* p, size_t avail, uint64_t& v)
+{
+    v = 0;
+    for (size_t i = 0; i < std::min(avail, MAX_VARINT_BYTES); ++i) {
+        v |= (uint64_t)(p[i] & 0x7F) << (7 * i);
+        if (!(p[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+// Where the index trailer (offsets, count, magic) starts, or 0 when the file doesn't end in one.
+size_t indexStart(const uint8_t* data, size_t size)
+{
+    if (size < HEADER_BYTES + 16 || memcmp(data + size - 8, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return 0;
+    uint64_t count = getU64(data + size - 16);
+    if (count > (size - HEADER_BYTES - 16) / 8) return 0;
+    return size - 16 - (size_t)count * 8;
+}
+
+size_t faceletCount(int size)
+{
+    return 6 * (size_t)size * size;
+}
+
+uint64_t toMs(double seconds)
+{
+    return seconds > 0.0 ? (uint64_t)std::llround(seconds * 1000.0) : 0;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// MoveLogWriter
+
+MoveLogWriter::~MoveLogWriter()
+{
+    close();
+}
+
+bool MoveLogWriter::open(const std::string& path, const Core& core, uint32_t checkpointInterval)
+{
+    close();
+    m_out.open(path, std::ios::binary | std::ios::trunc);
+    if (!m_out) return false;
+
+    m_size = core.size();
+    m_interval = std::max(checkpointInterval, 1u);
+    m_turns = 0;
+    m_written = 0;
+    m_failed = false;
+    m_buffer.clear();
+    m_checkpoints.clear();
+
+    m_buffer.insert(m_buffer.end(), LOG_MAGIC, LOG_MAGIC + sizeof(LOG_MAGIC));
+    m_buffer.push_back((uint8_t)LOG_VERSION);
+    m_buffer.push_back((uint8_t)(LOG_VERSION >> 8));
+    m_buffer.push_back((uint8_t)m_size);
+    m_buffer.push_back(0);
+    for (int i = 0; i < 4; ++i) m_buffer.push_back((uint8_t)(m_interval >> (8 * i)));
+
+    // the starting state, so checkpoint 0 is where a replay begins
+    m_lastTimeMs = toMs(core.clockSeconds());
+    appendCheckpoint(TAG_CHECKPOINT, m_lastTimeMs, core);
+    return flush();
+}
+
+bool MoveLogWriter::close()
+{
+    if (!m_out.is_open()) return !m_failed;
+    for (uint64_t offset : m_checkpoints) putU64(m_buffer, offset);
+    putU64(m_buffer, m_checkpoints.size());
+    m_buffer.insert(m_buffer.end(), INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+    flush();
+    m_out.close();
+    if (!m_out) m_failed = true;
+    return !m_failed;
+}
+
+bool MoveLogWriter::isOpen() const
+{
+    return m_out.is_open();
+}
+
+bool MoveLogWriter::flush()
+{
+    if (!m_out.is_open()) return false;
+    if (!m_buffer.empty()) {
+        m_out.write((const char*)m_buffer.data(), (std::streamsize)m_buffer.size());
+        m_written += m_buffer.size();
+        m_buffer.clear();
+    }
+    m_out.flush();
+    if (!m_out) m_failed = true;
+    return !m_failed;
+}
+
+uint64_t MoveLogWriter::turnCount() const
+{
+    return m_turns;
+}
+
+void MoveLogWriter::appendTime(uint64_t timeMs)
+{
+    // the clock never runs backwards, but a log spliced from two Cores might
+    uint64_t delta = timeMs > m_lastTimeMs ? timeMs - m_lastTimeMs : 0;
+    m_lastTimeMs += delta;
+    putVarint(m_buffer, delta);
+}
+
+void MoveLogWriter::appendTurn(const LayerTurn& turn, double timeSeconds, const Core& core)
+{
+    if (!m_out.is_open() || core.size() != m_size) return;
+    Move m;
+    if (layerTurnToMove(turn, m_size, m)) {
+        m_buffer.push_back((uint8_t)m);
+    } else {
+        m_buffer.push_back(TAG_LAYER_TURN);
+        m_buffer.push_back((uint8_t)(turn.axis | (turn.quarterTurns - 1) << 2));
+        m_buffer.push_back(turn.first);
+        m_buffer.push_back(turn.last);
+    }
+    appendTime(toMs(timeSeconds));
+    if (++m_turns % m_interval == 0) appendCheckpoint(TAG_CHECKPOINT, m_lastTimeMs, core);
+    if (m_buffer.size() >= FLUSH_BYTES) flush();
+}
+
+void MoveLogWriter::appendStateJump(double timeSeconds, const Core& core)
+{
+    if (!m_out.is_open() || core.size() != m_size) return;
+    uint64_t timeMs = toMs(timeSeconds);
+    m_lastTimeMs = std::max(m_lastTimeMs, timeMs);
+    appendCheckpoint(TAG_STATE_JUMP, m_lastTimeMs, core);
+    if (m_buffer.size() >= FLUSH_BYTES) flush();
+}
+
+void MoveLogWriter::appendCheckpoint(uint8_t tag, uint64_t timeMs, const Core& core)
+{
+    m_checkpoints.push_back(m_written + m_buffer.size());
+    m_buffer.push_back(tag);
+    putVarint(m_buffer, timeMs);
+    putVarint(m_buffer, m_turns);
+    putU64(m_buffer, core.stateHash());
+
+    size_t n = faceletCount(m_size);
+    m_colors.resize(n);
+    core.writeFaceletColors(m_colors.data());
+    for (size_t i = 0; i < n; i += 2)
+        m_buffer.push_back((uint8_t)(m_colors[i] | (i + 1 < n ? m_colors[i + 1] << 4 : 0)));
+}
+
+// ---------------------------------------------------------------------------
+// MoveLogReader
+
+bool MoveLogReader::open(const std::string& path)
+{
+    close();
+    if (!m_file.open(path)) return false;
+    const uint8_t* p = m_file.data();
+    bool ok = m_file.size() >= HEADER_BYTES && memcmp(p, LOG_MAGIC, sizeof(LOG_MAGIC)) == 0 &&
+              (p[8] | p[9] << 8) == LOG_VERSION && p[10] >= Core::kMinSize && p[10] <= Core::kMaxSize;
+    if (!ok) {
+        m_file.close();
+        return false;
+    }
+    m_data = p;
+    m_size = p[10];
+    m_interval = (uint32_t)p[12] | (uint32_t)p[13] << 8 | (uint32_t)p[14] << 16 | (uint32_t)p[15] << 24;
+    if (!loadIndex()) scanIndex();
+    rewind();
+    return true;
+}
+
+void MoveLogReader::close()
+{
+    m_file.close();
+    m_data = nullptr;
+    m_end = 0;
+    m_checkpoints.clear();
+    m_size = 0;
+    m_interval = 0;
+    m_truncated = false;
+    m_cursor = 0;
+    m_turnIndex = 0;
+    m_timeMs = 0;
+}
+
+bool MoveLogReader::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+int MoveLogReader::cubeSize() const
+{
+    return m_size;
+}
+
+uint32_t MoveLogReader::checkpointInterval() const
+{
+    return m_interval;
+}
+
+bool MoveLogReader::truncated() const
+{
+    return m_truncated;
+}
+
+bool MoveLogReader::loadIndex()
+{
+    // trailer: offsets, count, magic; every offset must point at a checkpoint record
+    size_t indexAt = indexStart(m_data, m_file.size());
+    if (!indexAt) return false;
+    size_t count = (m_file.size() - 16 - indexAt) / 8;
+
+    m_end = indexAt;
+    m_checkpoints.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        uint64_t at = getU64(m_data + indexAt + 8 * k);
+        Record r;
+        if (at < HEADER_BYTES || at >= indexAt || (k > 0 && at <= m_checkpoints[k - 1]) ||
+            (m_data[at] != TAG_CHECKPOINT && m_data[at] != TAG_STATE_JUMP) || !decode((size_t)at, 0, r)) {
+            m_checkpoints.clear();
+            return false;
+        }
+        m_checkpoints[k] = at;
+    }
+    return !m_checkpoints.empty();
+}
+
+void MoveLogReader::scanIndex()
+{
+    // no (valid) index: the writer didn't close, or the index is damaged; walk the records up
+    // to the last complete one. A trailer that is still there bounds the walk, so its offsets
+    // are never decoded as records.
+    m_truncated = true;
+    size_t indexAt = indexStart(m_data, m_file.size());
+    m_end = indexAt ? indexAt : m_file.size();
+    m_checkpoints.clear();
+    size_t at = HEADER_BYTES;
+    uint64_t timeMs = 0;
+    Record r;
+    while (size_t len = decode(at, timeMs, r)) {
+        if (r.tag == TAG_CHECKPOINT || r.tag == TAG_STATE_JUMP) m_checkpoints.push_back(at);
+        timeMs = r.timeMs;
+        at += len;
+    }
+    m_end = at;
+}
+
+size_t MoveLogReader::decode(size_t at, uint64_t lastTimeMs, Record& r) const
+{
+    if (at >= m_end) return 0;
+    const uint8_t* p = m_data + at;
+    size_t avail = m_end - at;
+    r.tag = p[0];
+    size_t len = 1;
+    uint64_t v;
+
+    if (r.tag < kMoveCount || r.tag == TAG_LAYER_TURN) {
+        if (r.tag < kMoveCount) {
+            r.turn = layerTurnFromMove((Move)r.tag, m_size);
+        } else {
+            if (avail < 4) return 0;
+            r.turn.axis = p[1] & 3;
+            r.turn.quarterTurns = (uint8_t)((p[1] >> 2) + 1);
+            r.turn.first = p[2];
+            r.turn.last = p[3];
+            if (!isValidLayerTurn(r.turn, m_size)) return 0;
+            len = 4;
+        }
+        size_t n = getVarint(p + len, avail - len, v);
+        if (!n) return 0;
+        r.timeMs = lastTimeMs + v;
+        return len + n;
+    }
+
+    if (r.tag != TAG_CHECKPOINT && r.tag != TAG_STATE_JUMP) return 0;
+    size_t n = getVarint(p + len, avail - len, r.timeMs);
+    if (!n) return 0;
+    len += n;
+    n = getVarint(p + len, avail - len, r.turnIndex);
+    if (!n) return 0;
+    len += n;
+    size_t colorBytes = (faceletCount(m_size) + 1) / 2;
+    if (avail - len < 8 + colorBytes) return 0;
+    r.hash = getU64(p + len);
+    r.colorsAt = at + len + 8;
+    return len + 8 + colorBytes;
+}
+
+bool MoveLogReader::restoreCheckpoint(const Record& r, Core& core) const
+{
+    if (core.size() != m_size) return false;
+    size_t n = faceletCount(m_size);
+    m_colors.resize(n);
+    for (size_t i = 0; i < n; ++i) m_colors[i] = (m_data[r.colorsAt + i / 2] >> (4 * (i & 1))) & 0xF;
+    return core.setFaceletColors(m_colors.data()) && core.stateHash() == r.hash;
+}
+
+size_t MoveLogReader::checkpointCount() const
+{
+    return m_checkpoints.size();
+}
+
+uint64_t MoveLogReader::checkpointTurnIndex(size_t k) const
+{
+    Record r;
+    return k < m_checkpoints.size() && decode((size_t)m_checkpoints[k], 0, r) ? r.turnIndex : 0;
+}
+
+uint64_t MoveLogReader::checkpointTimeMs(size_t k) const
+{
+    Record r;
+    return k < m_checkpoints.size() && decode((size_t)m_checkpoints[k], 0, r) ? r.timeMs : 0;
+}
+
+void MoveLogReader::rewind()
+{
+    m_cursor = HEADER_BYTES;
+    m_turnIndex = 0;
+    m_timeMs = 0;
+}
+
+bool MoveLogReader::seekCheckpoint(size_t k, Core& core)
+{
+    Record r;
+    if (k >= m_checkpoints.size()) return false;
+    size_t len = decode((size_t)m_checkpoints[k], 0, r);
+    if (!len || !restoreCheckpoint(r, core)) return false;
+    m_cursor = (size_t)m_checkpoints[k] + len;
+    m_turnIndex = r.turnIndex;
+    m_timeMs = r.timeMs;
+    return true;
+}
+
+bool MoveLogReader::seekTurn(uint64_t turnIndex, Core& core)
+{
+    // the last checkpoint at or before turnIndex (turn indices never decrease along the log)
+    size_t lo = 0, hi = m_checkpoints.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (checkpointTurnIndex(mid) <= turnIndex) lo = mid;
+        else hi = mid;
+    }
+    if (!seekCheckpoint(lo, core)) return false;
+    if (m_turnIndex > turnIndex) return false;
+    applyTurns(core, turnIndex - m_turnIndex);
+    return m_turnIndex == turnIndex;
+}
+
+MoveLogEvent MoveLogReader::next(MoveLogEntry& out)
+{
+    Record r;
+    while (size_t len = decode(m_cursor, m_timeMs, r)) {
+        m_cursor += len;
+        m_timeMs = r.timeMs;
+        if (r.tag == TAG_CHECKPOINT) continue;
+        if (r.tag == TAG_STATE_JUMP) {
+            m_jump = r;
+            return MoveLogEvent::StateJump;
+        }
+        out.turn = r.turn;
+        out.timeMs = r.timeMs;
+        out.index = m_turnIndex++;
+        return MoveLogEvent::Turn;
+    }
+    return MoveLogEvent::End;
+}
+
+bool MoveLogReader::restoreState(Core& core) const
+{
+    return m_jump.tag == TAG_STATE_JUMP && restoreCheckpoint(m_jump, core);
+}
+
+size_t MoveLogReader::applyTurns(Core& core, uint64_t maxTurns)
+{
+    const size_t BATCH = 4096;
+    m_batch.clear();
+    uint64_t applied = 0;
+    MoveLogEntry e;
+    while (applied < maxTurns) {
+        MoveLogEvent ev = next(e);
+        if (ev == MoveLogEvent::End) break;
+        if (ev == MoveLogEvent::StateJump) {
+            core.applySequence(m_batch.data(), m_batch.size());
+            m_batch.clear();
+            restoreState(core);
+            continue;
+        }
+        m_batch.push_back(e.turn);
+        ++applied;
+        if (m_batch.size() == BATCH) {
+            core.applySequence(m_batch.data(), m_batch.size());
+            m_batch.clear();
+        }
+    }
+    core.applySequence(m_batch.data(), m_batch.size());
+    return (size_t)applied;
+}
+
+size_t MoveLogReader::queueTurnsUntil(Core& core, uint64_t timeMs)
+{
+    size_t queued = 0;
+    Record r;
+    MoveLogEntry e;
+    while (size_t len = decode(m_cursor, m_timeMs, r)) {
+        if (r.timeMs > timeMs) break;
+        if (r.tag == TAG_CHECKPOINT) {
+            // stepped over here: next() would run on past it into a later turn
+            m_cursor += len;
+            m_timeMs = r.timeMs;
+        } else if (next(e) == MoveLogEvent::Turn) {
+            if (core.queueMove(e.turn)) ++queued;
+        } else {
+            restoreState(core);
+        }
+    }
+    return queued;
+}
+
+uint64_t MoveLogReader::turnIndex() const
+{
+    return m_turnIndex;
+}
+
+uint64_t MoveLogReader::timeMs() const
+{
+    return m_timeMs;
+}
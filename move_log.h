@@ -0,0 +1,182 @@
+#ifndef MOVE_LOG_H
+#define MOVE_LOG_H
+
+// MoveLogWriter / MoveLogReader - compact binary record of the turns a Core applied
+// - Append-only: a 16-byte header, then one record per turn (1-byte move code, or a 4-byte
+//   layer turn on slice/wide turns, followed by the time since the previous record in ms as a
+//   LEB128 varint), so a timed 3x3 solve costs ~2 bytes per move
+// - Every checkpointInterval turns, and whenever the Core jumps to a new state, a checkpoint
+//   record stores the full logical state (4 bits per facelet) and its stateHash(); closing the
+//   writer appends an index of them, so the reader can seek without scanning
+// - The reader maps the file read-only (MappedFile) and decodes in place; a log that was never
+//   closed (crash, still being written) is read up to its last complete record and its
+//   checkpoints are found by one scan
+// - Turns are recorded as they land in Core's logical state (animated or headless), so a
+//   replay always reaches the recorded state: turns dropped from the queue never appear
+// Usage:
+//   MoveLogWriter log;
+//   log.open("session.rcml", core);
+//   core.setMoveRecorder(&log);
+//   ...
+//   core.setMoveRecorder(nullptr);
+//   log.close();
+//
+//   MoveLogReader r;
+//   if (r.open("session.rcml")) {
+//       Core replay(1.0f, 0.03f, 360.0f, r.cubeSize());
+//       r.seekTurn(100000, replay);   // checkpoint at or before, then headless up to turn 100000
+//       r.applyTurns(replay);         // the rest, headless
+//   }
+//
+// File layout (all integers little-endian):
+//   header      "RCMOVLOG", u16 version, u8 cube size, u8 0, u32 checkpoint interval
+//   turn        u8 Move (0..17, outer turns) | 0x20, u8 axis | (quarterTurns - 1) << 2,
+//               u8 first, u8 last; then varint ms since the previous record
+//   checkpoint  u8 0x30 (periodic) | 0x31 (state jump), varint time ms, varint turns before it,
+//               u64 stateHash, 6 * N * N color ids two per byte (low nibble first)
+//   index       u64 offset per checkpoint, u64 count, "RCMLIDX1" (written by close())
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "move.h"
+
+class Core;
+
+class MoveLogWriter {
+public:
+    MoveLogWriter() = default;
+    ~MoveLogWriter();
+
+    MoveLogWriter(const MoveLogWriter&) = delete;
+    MoveLogWriter& operator=(const MoveLogWriter&) = delete;
+
+    // Create (or truncate) `path` for a log of core.size() cubes, starting with a checkpoint of
+    // core's current state at core.clockSeconds(). Returns false if the file can't be created.
+    bool open(const std::string& path, const Core& core, uint32_t checkpointInterval = 4096);
+    // Flush, append the checkpoint index and close. Returns false if any write failed.
+    bool close();
+    bool isOpen() const;
+
+    // `turn` has just landed on `core` at timeSeconds (Core::setMoveRecorder() calls these).
+    void appendTurn(const LayerTurn& turn, double timeSeconds, const Core& core);
+    // `core` jumped to a new state without turning (setCubieState()/setFaceletColors()).
+    void appendStateJump(double timeSeconds, const Core& core);
+
+    // Hand buffered records to the OS (a reader opened afterwards sees them).
+    bool flush();
+    uint64_t turnCount() const;
+
+private:
+    void appendCheckpoint(uint8_t tag, uint64_t timeMs, const Core& core);
+    void appendTime(uint64_t timeMs);
+
+    std::ofstream m_out;
+    std::vector<uint8_t> m_buffer;       // records not yet written
+    std::vector<uint64_t> m_checkpoints; // file offsets, for the index
+    std::vector<uint8_t> m_colors;       // checkpoint scratch
+    uint64_t m_written = 0;              // bytes handed to m_out
+    uint64_t m_turns = 0;
+    uint64_t m_lastTimeMs = 0;
+    uint32_t m_interval = 0;
+    int m_size = 0;
+    bool m_failed = false;
+};
+
+// What MoveLogReader::next() stopped at.
+enum class MoveLogEvent : uint8_t {
+    End,       // no more records
+    Turn,      // a turn, in the entry
+    StateJump  // the recorded Core jumped to a new state; restoreState() applies it
+};
+
+struct MoveLogEntry {
+    LayerTurn turn;
+    uint64_t timeMs = 0; // time of the record (Core::clockSeconds() * 1000 when recorded)
+    uint64_t index = 0;  // turns before this one
+};
+
+class MoveLogReader {
+public:
+    MoveLogReader() = default;
+
+    MoveLogReader(const MoveLogReader&) = delete;
+    MoveLogReader& operator=(const MoveLogReader&) = delete;
+
+    // Map `path` and load (or rebuild) its checkpoint index; the cursor starts at the first
+    // record. Returns false if the file is missing or not a move log of a supported version.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    int cubeSize() const;
+    uint32_t checkpointInterval() const;
+    // True if the log was not closed cleanly, or ended in the middle of a record.
+    bool truncated() const;
+
+    size_t checkpointCount() const;
+    uint64_t checkpointTurnIndex(size_t k) const; // turns recorded before checkpoint k
+    uint64_t checkpointTimeMs(size_t k) const;
+
+    // Back to the first record (which is the checkpoint of the starting state).
+    void rewind();
+    // Put `core` (of cubeSize()) into checkpoint k's state and continue after it. Returns false,
+    // leaving the cursor alone, if k is out of range, the size differs or the state doesn't
+    // match its recorded hash.
+    bool seekCheckpoint(size_t k, Core& core);
+    // Put `core` into the state after `turnIndex` turns: the closest checkpoint at or before,
+    // then the turns in between through the headless path. False as seekCheckpoint(), or if
+    // the log has fewer turns (core is then at the last one).
+    bool seekTurn(uint64_t turnIndex, Core& core);
+
+    // Low-level cursor: the next turn or state jump; periodic checkpoints are skipped.
+    MoveLogEvent next(MoveLogEntry& out);
+    // Apply the state jump next() just returned. False if it doesn't match its hash.
+    bool restoreState(Core& core) const;
+
+    // Replay up to maxTurns turns headlessly, in batches through Core::applySequence(), state
+    // jumps included. Returns the number of turns applied.
+    size_t applyTurns(Core& core, uint64_t maxTurns = UINT64_MAX);
+    // Timed playback: queueMove() every turn stamped at or before timeMs (state jumps land
+    // at once). Returns the number of turns the queue accepted; under QueueOverflow::Reject a
+    // full queue drops the rest, so playback should use ApplyOldest or a backlog policy.
+    size_t queueTurnsUntil(Core& core, uint64_t timeMs);
+
+    uint64_t turnIndex() const; // turns read so far
+    uint64_t timeMs() const;    // time of the last record read
+
+private:
+    struct Record {
+        uint8_t tag;
+        LayerTurn turn;
+        uint64_t timeMs;     // absolute
+        uint64_t turnIndex;  // checkpoints only
+        size_t colorsAt;     // checkpoints only: offset of the packed colors
+        uint64_t hash;       // checkpoints only
+    };
+    // Decode the record at m_data[at] into r; returns its length, 0 if malformed or cut off.
+    size_t decode(size_t at, uint64_t lastTimeMs, Record& r) const;
+    bool restoreCheckpoint(const Record& r, Core& core) const;
+    bool loadIndex();
+    void scanIndex();
+
+    MappedFile m_file;
+    const uint8_t* m_data = nullptr;
+    size_t m_end = 0;                   // end of the records (start of the index, if any)
+    std::vector<uint64_t> m_checkpoints; // record offsets
+    std::vector<LayerTurn> m_batch;      // applyTurns() scratch
+    mutable std::vector<uint8_t> m_colors;
+    size_t m_cursor = 0;
+    uint64_t m_turnIndex = 0;
+    uint64_t m_timeMs = 0;
+    Record m_jump = {};                  // the state jump next() stopped at
+    uint32_t m_interval = 0;
+    int m_size = 0;
+    bool m_truncated = false;
+};
+
+#endif // MOVE_LOG_H
@@ -0,0 +1,92 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+// MpscQueue - bounded lock-free multi-producer / single-consumer queue
+// - Any number of threads may tryPush() concurrently; exactly one thread may tryPop();
+//   empty() may be called from any thread
+// - Producers never block or take a lock: a full queue makes tryPush() return false
+// - Per-cell sequence numbers (Vyukov's bounded queue) hand each slot from producer to
+//   consumer, so a slow producer never exposes a half-written value
+// - Capacity is rounded up to a power of two
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        m_mask = cap - 1;
+        m_cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i) m_cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Thread-safe. Returns false when the queue is full.
+    bool tryPush(const T& v)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                // slot is free for this position; claim it
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // consumer hasn't freed this slot yet: full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = v;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Returns false when nothing is ready.
+    bool tryPop(T& out)
+    {
+        // only this thread writes the position, so it reads it back relaxed
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell = &m_cells[pos & m_mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return false;
+        out = cell->value;
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Any thread. Approximate while producers or the consumer are active (a push counts as
+    // soon as it has claimed its slot); exact once they are quiet. Never reports empty while
+    // a push that returned before the call is still waiting to be popped.
+    bool empty() const
+    {
+        size_t dequeue = m_dequeuePos.load(std::memory_order_acquire);
+        return m_enqueuePos.load(std::memory_order_acquire) == dequeue;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0}; // shared by producers
+    alignas(64) std::atomic<size_t> m_dequeuePos{0}; // written by the consumer only
+};
+
+#endif // MPSC_QUEUE_H
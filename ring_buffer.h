@@ -0,0 +1,62 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+// RingBuffer - fixed-capacity FIFO with O(1) push/pop and no allocation after setup
+// - Capacity is rounded up to a power of two so wrapping is a mask
+// - Single-threaded; see MpscQueue for cross-thread submission
+
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity = 0) { reset(capacity); }
+
+    // Drops all contents and reallocates storage for at least `capacity` items.
+    void reset(size_t capacity)
+    {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_items.assign(capacity ? cap : 0, T());
+        m_mask = cap - 1;
+        m_head = m_tail = 0;
+    }
+
+    size_t capacity() const { return m_items.size(); }
+    size_t size() const { return m_tail - m_head; }
+    bool empty() const { return m_head == m_tail; }
+    bool full() const { return size() == capacity(); }
+
+    // Returns false (and stores nothing) when full.
+    bool push(const T& v)
+    {
+        if (full()) return false;
+        m_items[m_tail++ & m_mask] = v;
+        return true;
+    }
+
+    const T& front() const { return m_items[m_head & m_mask]; }
+    // i-th item from the front, i < size()
+    const T& at(size_t i) const { return m_items[(m_head + i) & m_mask]; }
+    T& at(size_t i) { return m_items[(m_head + i) & m_mask]; }
+
+    // Precondition: !empty()
+    T pop()
+    {
+        return m_items[m_head++ & m_mask];
+    }
+
+    // Drops the newest item. Precondition: !empty()
+    void popBack() { --m_tail; }
+
+    void clear() { m_head = m_tail = 0; }
+
+private:
+    std::vector<T> m_items;
+    size_t m_mask = 0;
+    size_t m_head = 0; // monotonically increasing; index with & m_mask
+    size_t m_tail = 0;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,158 @@
+#include "scene.h"
+
+#include <cmath>
+#include <algorithm>
+
+Frustum Frustum::fromMatrix(const glm::mat4& clip)
+{
+    // Gribb/Hartmann: each plane is row 3 +/- row k of the clip matrix (GLM is column-major)
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; ++r) row[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+
+    Frustum f;
+    for (int k = 0; k < 3; ++k) {
+        f.planes[2 * k] = row[3] + row[k];
+        f.planes[2 * k + 1] = row[3] - row[k];
+    }
+    // normalize so plane distances are in world units (sphere radii compare directly)
+    for (glm::vec4& p : f.planes) {
+        float len = glm::length(glm::vec3(p));
+        if (len > 0.0f) p /= len;
+    }
+    return f;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& p : planes) {
+        if (glm::dot(glm::vec3(p), center) + p.w < -radius) return false;
+    }
+    return true;
+}
+
+size_t CubeScene::addCube(const glm::mat4& world, int size, float cubieSize, float gap, float animSpeedDegPerSec)
+{
+    size_t id = m_cubes.size();
+    m_cubes.emplace_back(new Core(cubieSize, gap, animSpeedDegPerSec, size));
+    const Core& c = *m_cubes.back();
+
+    // half the lattice extent plus the sticker offset, out to the corner
+    float half = 0.5f * c.size() * (cubieSize + gap) + 0.01f;
+    m_localRadius.push_back(half * std::sqrt(3.0f));
+    m_world.push_back(world);
+    m_bounds.push_back(glm::vec4(0.0f));
+    m_firstSticker.push_back(m_totalStickers);
+    m_totalStickers += c.stickerCount();
+    updateBounds(id);
+
+    ++m_layoutVersion;
+    ++m_worldVersion;
+    return id;
+}
+
+void CubeScene::clear()
+{
+    m_cubes.clear();
+    m_world.clear();
+    m_bounds.clear();
+    m_localRadius.clear();
+    m_firstSticker.clear();
+    m_totalStickers = 0;
+    ++m_layoutVersion;
+    ++m_worldVersion;
+}
+
+size_t CubeScene::cubeCount() const
+{
+    return m_cubes.size();
+}
+
+Core& CubeScene::cube(size_t id)
+{
+    return *m_cubes[id];
+}
+
+const Core& CubeScene::cube(size_t id) const
+{
+    return *m_cubes[id];
+}
+
+const glm::mat4& CubeScene::worldTransform(size_t id) const
+{
+    return m_world[id];
+}
+
+const std::vector<glm::mat4>& CubeScene::worldTransforms() const
+{
+    return m_world;
+}
+
+void CubeScene::setWorldTransform(size_t id, const glm::mat4& world)
+{
+    m_world[id] = world;
+    updateBounds(id);
+    ++m_worldVersion;
+}
+
+const glm::vec4& CubeScene::boundingSphere(size_t id) const
+{
+    return m_bounds[id];
+}
+
+void CubeScene::updateBounds(size_t id)
+{
+    const glm::mat4& w = m_world[id];
+    // the largest axis scale bounds how far the transform can stretch the sphere
+    float scale = std::max(glm::length(glm::vec3(w[0])), std::max(glm::length(glm::vec3(w[1])), glm::length(glm::vec3(w[2]))));
+    m_bounds[id] = glm::vec4(glm::vec3(w[3]), m_localRadius[id] * scale);
+}
+
+size_t CubeScene::totalStickerCount() const
+{
+    return m_totalStickers;
+}
+
+size_t CubeScene::firstSticker(size_t id) const
+{
+    return m_firstSticker[id];
+}
+
+size_t CubeScene::cubeGrain(const TaskPool& pool) const
+{
+    // a few chunks per worker leaves room for stealing without drowning in tiny tasks
+    return std::max<size_t>(1, m_cubes.size() / (pool.workerCount() * 8));
+}
+
+void CubeScene::update(float deltaSeconds, TaskPool* pool)
+{
+    forEachCube(pool, [deltaSeconds](Core& c, size_t) { c.update(deltaSeconds); });
+}
+
+size_t CubeScene::writeStickerTransforms(StickerTransform* out, size_t count, TaskPool* pool)
+{
+    if (count < m_totalStickers) return 0;
+    forEachCube(pool, [&](Core& c, size_t id) {
+        c.writeStickerTransforms(out + m_firstSticker[id], c.stickerCount());
+    });
+    return m_totalStickers;
+}
+
+size_t CubeScene::cullVisible(const Frustum& frustum, std::vector<uint32_t>& out) const
+{
+    out.clear(); // keeps capacity
+    for (size_t i = 0; i < m_bounds.size(); ++i) {
+        const glm::vec4& b = m_bounds[i];
+        if (frustum.intersectsSphere(glm::vec3(b), b.w)) out.push_back((uint32_t)i);
+    }
+    return out.size();
+}
+
+uint64_t CubeScene::layoutVersion() const
+{
+    return m_layoutVersion;
+}
+
+uint64_t CubeScene::worldVersion() const
+{
+    return m_worldVersion;
+}
@@ -0,0 +1,108 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+// CubeScene - many independent Core instances placed in one world
+// - Owns the cubes (each with its own size, speed and world transform) and updates them together
+// - Stickers of all cubes share one scene-wide order: cube 0's stickers, then cube 1's, ...
+//   (firstSticker(id) is where a cube starts), so a renderer can keep one instance buffer
+// - Keeps a world-space bounding sphere per cube for CPU frustum culling (see Frustum)
+// - layoutVersion() changes when cubes are added/removed, worldVersion() when any world
+//   transform changes, so renderers rebuild static data only when needed
+// - Per-cube work (update, transform export, headless replays through forEachCube) can be
+//   spread over a TaskPool; each task owns a chunk of cubes and writes only their slice
+// Usage:
+//   CubeScene scene;
+//   size_t id = scene.addCube(glm::translate(glm::mat4(1.0f), pos));
+//   scene.cube(id).queueMove("R");
+//   // each frame:
+//   scene.update(deltaSeconds, &pool);   // pool optional
+//   std::vector<uint32_t> visible;
+//   scene.cullVisible(Frustum::fromMatrix(projection * view), visible);
+//
+// Requires GLM. No GLFW/glad calls here.
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "core.h"
+#include "task_pool.h"
+
+// Six clip planes (left, right, bottom, top, near, far) with inward-pointing normals.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Extract planes from a clip matrix (projection * view); works for any GL-style projection.
+    static Frustum fromMatrix(const glm::mat4& clip);
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
+
+class CubeScene {
+public:
+    CubeScene() = default;
+    CubeScene(const CubeScene&) = delete;
+    CubeScene& operator=(const CubeScene&) = delete;
+
+    // Add a cube; arguments after `world` are passed to Core's constructor. Returns its id
+    // (ids are dense: 0..cubeCount()-1). Core objects never move, so references stay valid.
+    size_t addCube(const glm::mat4& world, int size = 3, float cubieSize = 0.9f, float gap = 0.03f,
+                   float animSpeedDegPerSec = 360.0f);
+    void clear();
+
+    size_t cubeCount() const;
+    Core& cube(size_t id);
+    const Core& cube(size_t id) const;
+
+    const glm::mat4& worldTransform(size_t id) const;
+    const std::vector<glm::mat4>& worldTransforms() const; // indexed by id, contiguous for upload
+    void setWorldTransform(size_t id, const glm::mat4& world);
+    // world-space bounding sphere: centre in xyz, radius in w
+    const glm::vec4& boundingSphere(size_t id) const;
+
+    size_t totalStickerCount() const;
+    size_t firstSticker(size_t id) const;
+
+    // Advance every cube's simulation, in parallel when a pool is given.
+    void update(float deltaSeconds, TaskPool* pool = nullptr);
+
+    // Export every cube's current transforms in scene order into out[0..totalStickerCount()).
+    // Returns the number written (0 if count is too small).
+    size_t writeStickerTransforms(StickerTransform* out, size_t count, TaskPool* pool = nullptr);
+
+    // Run fn(Core&, id) for every cube; with a pool, chunks of cubes run concurrently, so fn may
+    // only touch its own cube (and its own slice of any shared output).
+    template<class Fn>
+    void forEachCube(TaskPool* pool, Fn&& fn)
+    {
+        if (!pool) {
+            for (size_t id = 0; id < m_cubes.size(); ++id) fn(*m_cubes[id], id);
+            return;
+        }
+        pool->parallelFor(m_cubes.size(), cubeGrain(*pool), [&](size_t b, size_t e) {
+            for (size_t id = b; id < e; ++id) fn(*m_cubes[id], id);
+        });
+    }
+
+    // Fill `out` with the ids (ascending) of cubes whose bounding sphere touches the frustum;
+    // returns how many there are.
+    size_t cullVisible(const Frustum& frustum, std::vector<uint32_t>& out) const;
+
+    uint64_t layoutVersion() const;
+    uint64_t worldVersion() const;
+
+private:
+    void updateBounds(size_t id);
+    size_t cubeGrain(const TaskPool& pool) const;
+
+    std::vector<std::unique_ptr<Core>> m_cubes;
+    std::vector<glm::mat4> m_world;
+    std::vector<glm::vec4> m_bounds;      // kept apart from the cubes so culling streams through it
+    std::vector<float> m_localRadius;     // bounding radius in the cube's own space
+    std::vector<size_t> m_firstSticker;
+    size_t m_totalStickers = 0;
+    uint64_t m_layoutVersion = 0;
+    uint64_t m_worldVersion = 0;
+};
+
+#endif // SCENE_H
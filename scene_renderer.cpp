@@ -0,0 +1,405 @@
+#include "scene_renderer.h"
+
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+static const char* sceneVertexSrc = R"glsl(
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in ivec4 aSticker; // per-instance PackedSticker: doubled lattice position, face | color << 3
+layout(location = 2) in int aCubeIndex; // per-instance owning cube
+
+uniform mat4 view;
+uniform mat4 projection;
+// Core::stickerGeometry() without the per-cube parts, and Core::colorPalette()
+uniform mat3 uFaceRotation[6];
+uniform vec3 uFaceNormal[6];
+uniform vec3 uPalette[6];
+// cube i: world matrix columns at texels 5i..5i+3, then (halfSpacing, surfaceOffset, sticker scale, size)
+uniform samplerBuffer uCubes;
+// texel i: (axis, turn count, first turn texel, 0) of cube i; a turn: (first, last layer, cos, sin)
+uniform samplerBuffer uAnims;
+
+out vec3 vColor;
+
+void main() {
+    int face = aSticker.w & 7;
+    vColor = uPalette[aSticker.w >> 3];
+    int base = aCubeIndex * 5;
+    mat4 world = mat4(texelFetch(uCubes, base), texelFetch(uCubes, base + 1),
+                      texelFetch(uCubes, base + 2), texelFetch(uCubes, base + 3));
+    vec4 geo = texelFetch(uCubes, base + 4);
+
+    // resting transform: the face's rotation * scale, moved to the sticker's lattice position
+    vec3 pos = vec3(aSticker.xyz);
+    vec3 local = uFaceRotation[face] * vec3(aPos.xy * geo.z, aPos.z)
+               + pos * geo.x + uFaceNormal[face] * geo.y;
+
+    // turning layers rotate about the cube's centre line: u -> c u + s v, v -> -s u + c v
+    vec4 state = texelFetch(uAnims, aCubeIndex);
+    int axis = int(state.x);
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    float layer = 0.5 * (pos[axis] + geo.w - 1.0); // the doubled coordinate is 2 * layer - (size - 1)
+    for (int i = 0; i < int(state.y); ++i) {
+        vec4 turn = texelFetch(uAnims, int(state.z) + i);
+        if (layer > turn.x - 0.5 && layer < turn.y + 0.5) {
+            float pu = local[u], pv = local[v];
+            local[u] = turn.z * pu - turn.w * pv;
+            local[v] = turn.w * pu + turn.z * pv;
+        }
+    }
+    gl_Position = projection * view * world * vec4(local, 1.0);
+}
+)glsl";
+
+static const char* sceneFragmentSrc = R"glsl(
+#version 330 core
+in vec3 vColor;
+out vec4 FragColor;
+void main() {
+    FragColor = vec4(vColor, 1.0);
+}
+)glsl";
+
+static GLuint compileStage(GLenum type, const char* src)
+{
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, nullptr);
+    glCompileShader(s);
+    GLint ok; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetShaderInfoLog(s, len, nullptr, &log[0]);
+        std::cerr << "Scene shader compile error: " << log << std::endl;
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+static GLuint linkSceneProgram()
+{
+    GLuint vs = compileStage(GL_VERTEX_SHADER, sceneVertexSrc);
+    GLuint fs = compileStage(GL_FRAGMENT_SHADER, sceneFragmentSrc);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glLinkProgram(prog);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len; glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(prog, len, nullptr, &log[0]);
+        std::cerr << "Scene program link error: " << log << std::endl;
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+bool SceneRenderer::create()
+{
+    destroy();
+    m_program = linkSceneProgram();
+    if (!m_program) return false;
+    m_locView = glGetUniformLocation(m_program, "view");
+    m_locProj = glGetUniformLocation(m_program, "projection");
+    m_locCubes = glGetUniformLocation(m_program, "uCubes");
+    m_locAnims = glGetUniformLocation(m_program, "uAnims");
+    // each run picks its instances through baseInstance, which is reserved before GL 4.2
+    m_indirect = GLAD_GL_VERSION_4_3 ||
+                 (GLAD_GL_ARB_multi_draw_indirect && (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_base_instance));
+    glUseProgram(m_program);
+    glUniform3fv(glGetUniformLocation(m_program, "uPalette"), 6, &Core::colorPalette()[0][0]);
+    glUseProgram(0);
+
+    // unit quad in the XY plane, same as the single-cube path
+    const float verts[] = {
+        -0.5f, -0.5f, 0.0f,   0.5f, -0.5f, 0.0f,   0.5f,  0.5f, 0.0f,
+        -0.5f, -0.5f, 0.0f,   0.5f,  0.5f, 0.0f,  -0.5f,  0.5f, 0.0f
+    };
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_quadVbo);
+    glGenBuffers(1, &m_instanceVbo);
+    glGenBuffers(1, &m_cubeIndexVbo);
+    glGenBuffers(1, &m_cubeBuffer);
+    glGenTextures(1, &m_cubeTexture);
+    glGenBuffers(1, &m_animBuffer);
+    glGenTextures(1, &m_animTexture);
+    if (m_indirect) glGenBuffers(1, &m_indirectBuffer);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_layoutVersion = ~0ull;
+    m_worldVersion = ~0ull;
+    return true;
+}
+
+void SceneRenderer::destroy()
+{
+    m_stream.destroy();
+    if (m_program) glDeleteProgram(m_program);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    GLuint buffers[] = { m_quadVbo, m_instanceVbo, m_cubeIndexVbo, m_cubeBuffer, m_animBuffer, m_indirectBuffer };
+    for (GLuint b : buffers) {
+        if (b) glDeleteBuffers(1, &b);
+    }
+    GLuint textures[] = { m_cubeTexture, m_animTexture };
+    for (GLuint t : textures) {
+        if (t) glDeleteTextures(1, &t);
+    }
+    m_program = m_vao = m_quadVbo = m_instanceVbo = m_cubeIndexVbo = 0;
+    m_cubeBuffer = m_cubeTexture = m_animBuffer = m_animTexture = m_indirectBuffer = 0;
+}
+
+void SceneRenderer::pointInstanceAttributes(size_t firstInstance)
+{
+    // m_vao must be bound. Location 1 PackedSticker (read as 4 integers), 2 cube index.
+    glBindBuffer(GL_ARRAY_BUFFER, m_stream.mapped() ? m_stream.buffer() : m_instanceVbo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 4, GL_BYTE, sizeof(PackedSticker),
+        (void*)(m_stickerBase + firstInstance * sizeof(PackedSticker)));
+    glVertexAttribDivisor(1, 1);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_cubeIndexVbo);
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 1, GL_INT, sizeof(GLint), (void*)(firstInstance * sizeof(GLint)));
+    glVertexAttribDivisor(2, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::rebuildLayout(const CubeScene& scene)
+{
+    size_t total = scene.totalStickerCount();
+    std::vector<GLint> cubeIndex(total);
+    for (size_t id = 0; id < scene.cubeCount(); ++id) {
+        size_t first = scene.firstSticker(id);
+        std::fill(cubeIndex.begin() + first, cubeIndex.begin() + first + scene.cube(id).stickerCount(), (GLint)id);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_cubeIndexVbo);
+    glBufferData(GL_ARRAY_BUFFER, total * sizeof(GLint), cubeIndex.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // preferred: stream the stickers through a persistent mapped buffer; else a staging copy
+    // and glBufferSubData
+    m_stream.destroy();
+    if (total > 0 && m_stream.create(GL_ARRAY_BUFFER, total * sizeof(PackedSticker))) {
+        m_staging.clear();
+        m_staging.shrink_to_fit();
+    } else {
+        m_staging.assign(total, PackedSticker());
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, total * sizeof(PackedSticker), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    for (std::vector<uint64_t>& uploaded : m_uploadedRest) uploaded.assign(scene.cubeCount(), ~0ull);
+    m_animGeneration.assign(scene.cubeCount(), ~0ull);
+    m_animVisible.clear();
+    m_animState.clear();
+
+    // the face rotations are the same for every cube; only their scale differs
+    if (scene.cubeCount() > 0) {
+        const StickerGeometry& g = scene.cube(0).stickerGeometry();
+        glm::mat3 rotation[6];
+        for (int f = 0; f < 6; ++f) {
+            glm::mat3 o(g.orientation[f]);
+            rotation[f] = glm::mat3(glm::normalize(o[0]), glm::normalize(o[1]), glm::normalize(o[2]));
+        }
+        glUseProgram(m_program);
+        glUniformMatrix3fv(glGetUniformLocation(m_program, "uFaceRotation"), 6, GL_FALSE, &rotation[0][0][0]);
+        glUniform3fv(glGetUniformLocation(m_program, "uFaceNormal"), 6, &g.normal[0][0]);
+        glUseProgram(0);
+    }
+
+    m_stickerBase = 0;
+    glBindVertexArray(m_vao);
+    pointInstanceAttributes(0);
+    glBindVertexArray(0);
+
+    m_layoutVersion = scene.layoutVersion();
+    m_worldVersion = ~0ull; // cube buffer is resized below
+}
+
+void SceneRenderer::uploadCubes(const CubeScene& scene)
+{
+    // world matrix and geometry, 5 texels per cube; tiny next to the stickers, so all of it
+    std::vector<glm::vec4> texels(scene.cubeCount() * 5);
+    for (size_t id = 0; id < scene.cubeCount(); ++id) {
+        const glm::mat4& world = scene.worldTransform(id);
+        const Core& c = scene.cube(id);
+        const StickerGeometry& g = c.stickerGeometry();
+        for (int col = 0; col < 4; ++col) texels[id * 5 + col] = world[col];
+        texels[id * 5 + 4] = glm::vec4(g.halfSpacing, g.surfaceOffset, glm::length(glm::vec3(g.orientation[0][0])),
+                                       (float)c.size());
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, m_cubeBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_cubeTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_cubeBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    m_worldVersion = scene.worldVersion();
+}
+
+void SceneRenderer::uploadStickers(CubeScene& scene)
+{
+    // which copy to bring up to date: the next stream region, or the single VBO
+    PackedSticker* dst = m_staging.data();
+    int region = 0;
+    if (m_stream.mapped()) {
+        region = m_stream.region();
+        bool stale = false;
+        for (uint32_t id : m_visible) {
+            if (scene.cube(id).restGeneration() != m_uploadedRest[region][id]) { stale = true; break; }
+        }
+        // nothing landed: keep drawing from the current region
+        if (stale) {
+            dst = (PackedSticker*)m_stream.beginWrite();
+            region = m_stream.region();
+        }
+        m_stickerBase = m_stream.regionOffset();
+    }
+
+    size_t dirtyLo = scene.totalStickerCount(), dirtyHi = 0;
+    m_dirty.clear();
+    std::vector<uint64_t>& uploaded = m_uploadedRest[region];
+    for (uint32_t id : m_visible) {
+        if (scene.cube(id).restGeneration() == uploaded[id]) continue;
+        m_dirty.push_back(id);
+        dirtyLo = std::min(dirtyLo, scene.firstSticker(id));
+        dirtyHi = std::max(dirtyHi, scene.firstSticker(id) + scene.cube(id).stickerCount());
+    }
+    // each cube writes only its own slice, so chunks can run concurrently
+    auto exportCubes = [&](size_t b, size_t e) {
+        for (size_t i = b; i < e; ++i) {
+            Core& c = scene.cube(m_dirty[i]);
+            c.writePackedStickers(dst + scene.firstSticker(m_dirty[i]), c.stickerCount());
+            uploaded[m_dirty[i]] = c.restGeneration();
+        }
+    };
+    if (m_pool) m_pool->parallelFor(m_dirty.size(), std::max<size_t>(1, m_dirty.size() / (m_pool->workerCount() * 8)), exportCubes);
+    else exportCubes(0, m_dirty.size());
+
+    if (!m_stream.mapped() && dirtyLo < dirtyHi) {
+        glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(dirtyLo * sizeof(PackedSticker)),
+                        (GLsizeiptr)((dirtyHi - dirtyLo) * sizeof(PackedSticker)), m_staging.data() + dirtyLo);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void SceneRenderer::uploadAnimations(const CubeScene& scene)
+{
+    bool changed = m_visible != m_animVisible;
+    for (size_t i = 0; i < m_visible.size() && !changed; ++i) {
+        changed = scene.cube(m_visible[i]).generation() != m_animGeneration[m_visible[i]];
+    }
+    if (!changed) return;
+
+    // headers for every cube (culled ones keep stale values, they aren't drawn), then the
+    // running turns of the visible cubes packed after them
+    size_t cubes = scene.cubeCount();
+    m_animState.resize(cubes);
+    for (uint32_t id : m_visible) {
+        const Core& c = scene.cube(id);
+        int count = c.layerAnimationCount();
+        int axis = 0;
+        size_t first = m_animState.size();
+        for (int i = 0; i < count; ++i) {
+            Core::LayerAnimation la = c.layerAnimation(i);
+            axis = la.axis.x != 0.0f ? 0 : (la.axis.y != 0.0f ? 1 : 2);
+            // layerModel is a rotation about the axis; the image of the next basis vector
+            // gives its cosine and sine
+            int u = (axis + 1) % 3, v = (axis + 2) % 3;
+            m_animState.push_back(glm::vec4((float)la.layerFirst, (float)la.layerLast,
+                                            la.layerModel[u][u], la.layerModel[u][v]));
+        }
+        m_animState[id] = glm::vec4((float)axis, (float)count, (float)first, 0.0f);
+        m_animGeneration[id] = c.generation();
+    }
+    m_animVisible = m_visible;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_animBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, m_animState.size() * sizeof(glm::vec4), m_animState.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_animTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_animBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+size_t SceneRenderer::draw(CubeScene& scene, const glm::mat4& view, const glm::mat4& projection)
+{
+    if (!m_program) return 0;
+    if (scene.layoutVersion() != m_layoutVersion) rebuildLayout(scene);
+    if (scene.cubeCount() == 0) return 0;
+    if (scene.worldVersion() != m_worldVersion) uploadCubes(scene);
+
+    scene.cullVisible(Frustum::fromMatrix(projection * view), m_visible);
+    if (m_visible.empty()) return 0;
+
+    uploadStickers(scene);
+    uploadAnimations(scene);
+
+    // one command per run of consecutive visible ids (their stickers are contiguous)
+    m_commands.clear();
+    for (size_t i = 0; i < m_visible.size(); ) {
+        uint32_t id = m_visible[i];
+        size_t first = scene.firstSticker(id);
+        size_t count = scene.cube(id).stickerCount();
+        for (++i; i < m_visible.size() && m_visible[i] == m_visible[i - 1] + 1; ++i) {
+            count += scene.cube(m_visible[i]).stickerCount();
+        }
+        m_commands.push_back({ 6, (GLuint)count, 0, (GLuint)first });
+    }
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_locView, 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(m_locProj, 1, GL_FALSE, &projection[0][0]);
+    glUniform1i(m_locCubes, 0);
+    glUniform1i(m_locAnims, 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_cubeTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, m_animTexture);
+    glBindVertexArray(m_vao);
+
+    if (m_indirect) {
+        pointInstanceAttributes(0); // this frame's stream region
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawArraysIndirectCommand),
+                     m_commands.data(), GL_STREAM_DRAW);
+        glMultiDrawArraysIndirect(GL_TRIANGLES, (void*)0, (GLsizei)m_commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+        // no baseInstance before GL 4.2: re-point the instance attributes per run instead
+        for (const DrawArraysIndirectCommand& cmd : m_commands) {
+            pointInstanceAttributes(cmd.baseInstance);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)cmd.instanceCount);
+        }
+        pointInstanceAttributes(0);
+    }
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    if (m_stream.mapped()) m_stream.fence();
+    return m_visible.size();
+}
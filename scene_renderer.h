@@ -0,0 +1,106 @@
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+// SceneRenderer - draws every cube of a CubeScene with a handful of GL calls
+// - Same pipeline as the single-cube view: one 4-byte PackedSticker per sticker (scene order)
+//   plus a per-instance cube index; the vertex shader rebuilds each resting transform from
+//   the face tables and the cube's geometry, and turns animating layers itself
+// - Per cube, a buffer texture holds the world matrix and geometry (halfSpacing,
+//   surfaceOffset, sticker scale, size); a second one, rewritten each frame something moved,
+//   holds the running turns (axis, then layer range and cos/sin of the angle per turn).
+//   A turning cube costs a few texels per frame, never a sticker re-export
+// - Sticker data only changes when a move lands (Core::restGeneration()); it streams through
+//   a persistently mapped StreamBuffer (each region remembers which cubes it holds), or
+//   glBufferSubData over the changed range without GL_ARB_buffer_storage
+// - Per frame: frustum-cull the cubes on the CPU, re-upload only visible cubes that changed,
+//   then draw the visible cubes, batched into runs of consecutive ids
+// - Draws all runs with one glMultiDrawArraysIndirect (GL 4.3, or GL_ARB_multi_draw_indirect
+//   plus GL 4.2 / GL_ARB_base_instance); otherwise one glDrawArraysInstanced per run
+// - Culled cubes keep their stale instance data and catch up when they come back into view
+// - With setTaskPool(), the dirty cubes write their slices of the instance data in parallel
+// Usage:
+//   SceneRenderer r;
+//   if (!r.create()) { /* shader error */ }
+//   // each frame, after scene.update(dt):
+//   r.draw(scene, view, projection);
+//   // at exit, with the context current:
+//   r.destroy();
+
+#include <glad/glad.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "scene.h"
+#include "stream_buffer.h"
+
+class SceneRenderer {
+public:
+    SceneRenderer() = default;
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    // Compiles the scene shader and creates the buffers. Returns false on a shader error.
+    bool create();
+    // Needs the GL context that created the objects to be current.
+    void destroy();
+
+    // Cull, upload what changed and draw. Returns the number of cubes drawn.
+    size_t draw(CubeScene& scene, const glm::mat4& view, const glm::mat4& projection);
+
+    bool usesIndirectDraw() const { return m_indirect; }
+    // True once a scene is laid out into the persistent mapped stream.
+    bool usesStreaming() const { return m_stream.mapped(); }
+
+    // Optional pool for the per-cube sticker export (nullptr = on the calling thread).
+    void setTaskPool(TaskPool* pool) { m_pool = pool; }
+
+private:
+    // layout of one GL_DRAW_INDIRECT_BUFFER entry (fixed by the GL spec)
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    void rebuildLayout(const CubeScene& scene);
+    void uploadCubes(const CubeScene& scene);
+    void uploadStickers(CubeScene& scene);
+    void uploadAnimations(const CubeScene& scene);
+    void pointInstanceAttributes(size_t firstInstance);
+
+    GLuint m_program = 0;
+    GLuint m_vao = 0;
+    GLuint m_quadVbo = 0;
+    GLuint m_instanceVbo = 0;  // PackedSticker per sticker, when not streaming
+    GLuint m_cubeIndexVbo = 0; // int per sticker: owning cube id
+    GLuint m_cubeBuffer = 0;   // 5 texels per cube: world matrix columns, geometry
+    GLuint m_cubeTexture = 0;
+    GLuint m_animBuffer = 0;   // a header texel per cube, then the running turns
+    GLuint m_animTexture = 0;
+    GLuint m_indirectBuffer = 0;
+    GLint m_locView = -1;
+    GLint m_locProj = -1;
+    GLint m_locCubes = -1;
+    GLint m_locAnims = -1;
+    bool m_indirect = false;
+    TaskPool* m_pool = nullptr;
+    StreamBuffer m_stream;
+
+    uint64_t m_layoutVersion = ~0ull; // force the first rebuild
+    uint64_t m_worldVersion = ~0ull;
+    size_t m_stickerBase = 0;                   // byte offset of this frame's instance data
+    std::vector<PackedSticker> m_staging;       // scene-wide, mirrors m_instanceVbo (not streaming)
+    // per cube, the restGeneration() its stickers were last written at: one list per stream
+    // region, or just [0] for m_instanceVbo
+    std::vector<uint64_t> m_uploadedRest[StreamBuffer::REGIONS];
+    std::vector<uint64_t> m_animGeneration;     // per cube, generation() its turns were written at
+    std::vector<uint32_t> m_animVisible;        // visible set m_animState was built for
+    std::vector<glm::vec4> m_animState;
+    std::vector<uint32_t> m_visible;
+    std::vector<uint32_t> m_dirty;              // visible cubes to re-export this frame
+    std::vector<DrawArraysIndirectCommand> m_commands;
+};
+
+#endif // SCENE_RENDERER_H
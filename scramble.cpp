@@ -0,0 +1,274 @@
+#include "scramble.h"
+#include "task_pool.h"
+#include "zobrist.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// separate key per kind of draw, so state i and move scramble i are unrelated
+const uint64_t DOMAIN_STATE = 1;
+const uint64_t DOMAIN_MOVES = 2;
+
+const size_t STATE_GRAIN = 1024;
+const size_t MOVES_GRAIN = 256;
+
+uint64_t streamKey(uint64_t seed, uint64_t domain)
+{
+    return zobristMix(seed ^ zobristMix(domain));
+}
+
+inline void mulHiLo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo)
+{
+    uint64_t p = (uint64_t)a * b;
+    hi = (uint32_t)(p >> 32);
+    lo = (uint32_t)p;
+}
+
+// Fisher-Yates over perm[0, n), the swap choices read as the mixed-radix digits of v (uniform
+// below n!); returns the parity (number of real swaps, mod 2)
+int shuffle(uint8_t* perm, int n, uint32_t v)
+{
+    int parity = 0;
+    for (int i = n - 1; i > 0; --i) {
+        int j = (int)(v % (uint32_t)(i + 1));
+        v /= (uint32_t)(i + 1);
+        std::swap(perm[i], perm[j]);
+        parity ^= j != i;
+    }
+    return parity;
+}
+
+// one bounded draw per coordinate (8!, 12!, 3^7 and 2^11 all fit in 32 bits), so a state
+// costs four draws
+CubieCube drawState(CounterRng& rng)
+{
+    CubieCube c;
+    int cornerParity = shuffle(c.cp, 8, rng.below(40320));
+    int edgeParity = shuffle(c.ep, 12, rng.below(479001600));
+    // a state of the wrong parity is paired with the one that swaps the last two edges, which
+    // keeps the result uniform over reachable states
+    if (cornerParity != edgeParity) std::swap(c.ep[10], c.ep[11]);
+
+    uint32_t twists = rng.below(2187);
+    int twist = 0;
+    for (int i = 0; i < 7; ++i, twists /= 3) twist += c.co[i] = (uint8_t)(twists % 3);
+    c.co[7] = (uint8_t)((3 - twist % 3) % 3);
+
+    uint32_t flips = rng.below(2048);
+    int flip = 0;
+    for (int i = 0; i < 11; ++i, flips >>= 1) flip += c.eo[i] = (uint8_t)(flips & 1);
+    c.eo[11] = (uint8_t)(flip & 1);
+    return c;
+}
+
+bool withinOneMove(const CubieCube& c)
+{
+    if (c.isSolved()) return true;
+    for (int m = 0; m < kMoveCount; ++m)
+        if (c == CubieCube::moveCube((Move)m)) return true;
+    return false;
+}
+
+// Draws random-move scramble turns as (face, depth, quarter turns). A turn on the same axis as
+// the previous one must use a layer block not yet turned since the axis last changed, which
+// rules out R R, R L R and, on big cubes, R Rw R.
+class MoveDraw {
+public:
+    MoveDraw(uint64_t key, uint64_t index, int size)
+        : m_rng(key, index), m_maxDepth(std::max(1, size / 2)) {}
+
+    void next(int& face, int& depth, int& quarterTurns)
+    {
+        for (;;) {
+            // face, depth and direction from one draw
+            uint32_t v = m_rng.below(18 * (uint32_t)m_maxDepth);
+            quarterTurns = 1 + (int)(v % 3);
+            face = (int)(v / 3 % 6);
+            depth = 1 + (int)(v / 18);
+            int axis = face % 3;
+            uint32_t bit = 1u << ((face / 3) * m_maxDepth + depth - 1);
+            if (axis == m_axis) {
+                if (m_used & bit) continue;
+                m_used |= bit;
+            } else {
+                m_axis = axis;
+                m_used = bit;
+            }
+            break;
+        }
+    }
+
+private:
+    CounterRng m_rng;
+    int m_maxDepth;
+    int m_axis = -1;
+    uint32_t m_used = 0; // layer blocks turned on m_axis, bit side * maxDepth + depth - 1
+};
+
+} // namespace
+
+void Philox4x32::block(uint64_t key, uint64_t counterLo, uint64_t counterHi, uint32_t out[4])
+{
+    uint32_t c0 = (uint32_t)counterLo, c1 = (uint32_t)(counterLo >> 32);
+    uint32_t c2 = (uint32_t)counterHi, c3 = (uint32_t)(counterHi >> 32);
+    uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+        uint32_t hi0, lo0, hi1, lo1;
+        mulHiLo(0xD2511F53u, c0, hi0, lo0);
+        mulHiLo(0xCD9E8D57u, c2, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += 0x9E3779B9u; // Weyl sequence key schedule
+        k1 += 0xBB67AE85u;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+CounterRng::CounterRng(uint64_t key, uint64_t stream)
+    : m_key(key), m_stream(stream)
+{
+}
+
+uint32_t CounterRng::next()
+{
+    if (m_used == 4) {
+        Philox4x32::block(m_key, m_block++, m_stream, m_out);
+        m_used = 0;
+    }
+    return m_out[m_used++];
+}
+
+uint32_t CounterRng::below(uint32_t bound)
+{
+    uint64_t m = (uint64_t)next() * bound;
+    if ((uint32_t)m < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while ((uint32_t)m < threshold) m = (uint64_t)next() * bound;
+    }
+    return (uint32_t)(m >> 32);
+}
+
+SolveOptions ScrambleGenerator::defaultSolveOptions()
+{
+    SolveOptions o;
+    o.maxLength = 24;
+    o.targetLength = 22;
+    o.timeLimitMs = 2000.0;
+    return o;
+}
+
+ScrambleGenerator::ScrambleGenerator(uint64_t seed, TaskPool* pool)
+    : m_seed(seed), m_pool(pool)
+{
+}
+
+uint64_t ScrambleGenerator::seed() const
+{
+    return m_seed;
+}
+
+CubieCube ScrambleGenerator::randomState(uint64_t index) const
+{
+    CounterRng rng(streamKey(m_seed, DOMAIN_STATE), index);
+    return drawState(rng);
+}
+
+void ScrambleGenerator::randomStates(uint64_t first, size_t count, CubieCube* out) const
+{
+    auto body = [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) out[k] = randomState(first + k);
+    };
+    if (m_pool) m_pool->parallelFor(count, STATE_GRAIN, body);
+    else body(0, count);
+}
+
+void ScrambleGenerator::randomMoveScramble(uint64_t index, int length, Move* out) const
+{
+    MoveDraw draw(streamKey(m_seed, DOMAIN_MOVES), index, 3);
+    for (int i = 0; i < length; ++i) {
+        int face, depth, qt;
+        draw.next(face, depth, qt);
+        out[i] = makeMove(face, qt);
+    }
+}
+
+void ScrambleGenerator::randomMoveScrambles(uint64_t first, size_t count, int length, Move* out) const
+{
+    auto body = [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) randomMoveScramble(first + k, length, out + k * length);
+    };
+    if (m_pool) m_pool->parallelFor(count, MOVES_GRAIN, body);
+    else body(0, count);
+}
+
+void ScrambleGenerator::randomMoveScramble(uint64_t index, int size, int length, LayerTurn* out) const
+{
+    MoveDraw draw(streamKey(m_seed, DOMAIN_MOVES), index, size);
+    for (int i = 0; i < length; ++i) {
+        int face, depth, qt;
+        draw.next(face, depth, qt);
+        // the outer turn in standard notation, widened inwards: Rw, 3Rw, ...
+        LayerTurn t = layerTurnFromMove(makeMove(face, qt), size);
+        if (t.first == 0) t.last = (uint8_t)(depth - 1);
+        else t.first = (uint8_t)(size - depth);
+        out[i] = t;
+    }
+}
+
+void ScrambleGenerator::randomMoveScrambles(uint64_t first, size_t count, int size, int length,
+                                            LayerTurn* out) const
+{
+    auto body = [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) randomMoveScramble(first + k, size, length, out + k * length);
+    };
+    if (m_pool) m_pool->parallelFor(count, MOVES_GRAIN, body);
+    else body(0, count);
+}
+
+bool ScrambleGenerator::randomStateScramble(uint64_t index, std::vector<Move>& out,
+                                            const SolveOptions& options) const
+{
+    // the first draw is randomState(index); redraws continue the same stream
+    CounterRng rng(streamKey(m_seed, DOMAIN_STATE), index);
+    CubieCube state = drawState(rng);
+    while (withinOneMove(state)) state = drawState(rng);
+
+    SolveOptions single = options;
+    single.threads = 1; // batches parallelize across scrambles instead
+    SolveResult r = Solver::solve(state, single);
+    out.clear();
+    if (!r.solved) return false;
+    // the solution takes the state to solved, so its inverse takes solved to the state
+    for (size_t i = r.moves.size(); i-- > 0;) out.push_back(inverseMove(r.moves[i]));
+    return true;
+}
+
+size_t ScrambleGenerator::randomStateScrambles(uint64_t first, size_t count, ScrambleBatch& out,
+                                               const SolveOptions& options) const
+{
+    Solver::prepare(); // build the tables once, before the workers race for them
+    std::vector<std::vector<Move>> scrambles(count);
+    std::vector<uint8_t> failed(count, 0);
+    auto body = [&](size_t b, size_t e) {
+        for (size_t k = b; k < e; ++k) failed[k] = !randomStateScramble(first + k, scrambles[k], options);
+    };
+    if (m_pool) m_pool->parallelFor(count, 1, body);
+    else body(0, count);
+
+    out.moves.clear();
+    out.offsets.assign(1, 0);
+    size_t failures = 0;
+    for (size_t k = 0; k < count; ++k) {
+        out.moves.insert(out.moves.end(), scrambles[k].begin(), scrambles[k].end());
+        out.offsets.push_back((uint32_t)out.moves.size());
+        failures += failed[k];
+    }
+    return failures;
+}
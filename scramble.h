@@ -0,0 +1,111 @@
+#ifndef SCRAMBLE_H
+#define SCRAMBLE_H
+
+// ScrambleGenerator - reproducible random states and scrambles, in bulk
+// - Randomness comes from Philox4x32-10, a counter-based RNG: scramble i always draws from the
+//   stream keyed by (seed, i), so the same seed gives the same scrambles whatever the thread
+//   count, batch split or order of generation
+// - Random states: uniform over the reachable 3x3 states (corner/edge permutations of equal
+//   parity, twist and flip sums fixed by the last cubie)
+// - Random-state scrambles (WCA style): a random state at least 2 moves from solved, scrambled
+//   into by the inverse of a Solver solution; cost is one solve each
+// - Random-move scrambles: `length` moves, never the same face twice in a row and never three
+//   turns on one axis (R L R); on NxN the outer and wide turns up to N/2 layers deep, never
+//   repeating a layer block on the same axis before turning another axis
+// - Batches run on a TaskPool when one is given, and write compact Move / LayerTurn codes that
+//   Core::applySequence(), CubieCube and FaceletCube take as they are
+// Usage:
+//   TaskPool pool;
+//   ScrambleGenerator gen(20261014, &pool);
+//   std::vector<Move> moves(100000 * 25);
+//   gen.randomMoveScrambles(0, 100000, 25, moves.data());   // scramble i at moves[25 * i]
+//   ScrambleBatch wca;
+//   gen.randomStateScrambles(0, 1000, wca);
+//   core.applySequence(wca.scramble(7), wca.length(7));
+//
+// No GL and no GLM here.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cubie.h"
+#include "move.h"
+#include "solver.h"
+
+class TaskPool;
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"): 128-bit block
+// number -> 128 random bits, under a 64-bit key.
+struct Philox4x32 {
+    static void block(uint64_t key, uint64_t counterLo, uint64_t counterHi, uint32_t out[4]);
+};
+
+// One stream (key, stream id) of Philox output, read 32 bits at a time.
+class CounterRng {
+public:
+    CounterRng(uint64_t key, uint64_t stream);
+
+    uint32_t next();
+    // uniform in [0, bound), bound > 0 (multiply-shift with rejection, no modulo bias)
+    uint32_t below(uint32_t bound);
+
+private:
+    uint64_t m_key;
+    uint64_t m_stream;
+    uint64_t m_block = 0;
+    uint32_t m_out[4];
+    int m_used = 4;
+};
+
+// Variable-length scrambles packed back to back.
+struct ScrambleBatch {
+    std::vector<Move> moves;
+    std::vector<uint32_t> offsets; // scramble i is moves[offsets[i], offsets[i + 1])
+
+    size_t count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    const Move* scramble(size_t i) const { return moves.data() + offsets[i]; }
+    size_t length(size_t i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+class ScrambleGenerator {
+public:
+    // What random-state scrambles solve with by default: any solution of up to 22 moves will
+    // do, so the search stops at the first one; the time limit only bounds failure.
+    static SolveOptions defaultSolveOptions();
+
+    // pool: run batches on it (not owned); nullptr = the calling thread only
+    explicit ScrambleGenerator(uint64_t seed, TaskPool* pool = nullptr);
+
+    uint64_t seed() const;
+
+    // the random state with this index
+    CubieCube randomState(uint64_t index) const;
+    // out[k] = randomState(first + k)
+    void randomStates(uint64_t first, size_t count, CubieCube* out) const;
+
+    // `length` face turns into out (3x3)
+    void randomMoveScramble(uint64_t index, int length, Move* out) const;
+    // out[k * length ...] = scramble first + k
+    void randomMoveScrambles(uint64_t first, size_t count, int length, Move* out) const;
+    // `length` outer/wide turns of a size x size cube into out; on 3x3 the same turns as the
+    // Move overload for the same index
+    void randomMoveScramble(uint64_t index, int size, int length, LayerTurn* out) const;
+    void randomMoveScrambles(uint64_t first, size_t count, int size, int length, LayerTurn* out) const;
+
+    // Moves from solved to a random state (drawn as randomState(), skipping states under 2
+    // moves from solved). Solves run one thread each (options.threads is ignored); false if the
+    // solver found nothing within the options.
+    bool randomStateScramble(uint64_t index, std::vector<Move>& out,
+                             const SolveOptions& options = defaultSolveOptions()) const;
+    // Replaces out with scrambles first .. first + count - 1; returns how many failed to solve
+    // (those are left empty).
+    size_t randomStateScrambles(uint64_t first, size_t count, ScrambleBatch& out,
+                                const SolveOptions& options = defaultSolveOptions()) const;
+
+private:
+    uint64_t m_seed;
+    TaskPool* m_pool;
+};
+
+#endif // SCRAMBLE_H
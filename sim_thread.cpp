@@ -0,0 +1,95 @@
+#include "sim_thread.h"
+
+#include <chrono>
+
+static StickerSnapshot makePrototype(const Core& core)
+{
+    StickerSnapshot s;
+    s.stickers.resize(core.stickerCount());
+    return s;
+}
+
+SimulationThread::SimulationThread(Core& core, double tickHz)
+    : m_core(core), m_tickSeconds(1.0 / tickHz), m_snapshots(makePrototype(core))
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+    stop();
+}
+
+void SimulationThread::start()
+{
+    if (m_running.load()) return;
+    // publish the current state before the render loop asks for it
+    m_publishedGeneration = ~0ull;
+    publishIfChanged();
+    m_running.store(true);
+    m_thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+    if (!m_running.exchange(false)) return;
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool SimulationThread::running() const
+{
+    return m_running.load();
+}
+
+bool SimulationThread::fetchSnapshot()
+{
+    return m_snapshots.fetch();
+}
+
+const StickerSnapshot& SimulationThread::snapshot() const
+{
+    return m_snapshots.readBuffer();
+}
+
+void SimulationThread::publishIfChanged()
+{
+    // a move queued behind a running turn changes only the queue depth
+    size_t depth = m_core.queuedMoveCount();
+    if (m_core.generation() == m_publishedGeneration && depth == m_publishedQueueDepth) return;
+    StickerSnapshot& s = m_snapshots.writeBuffer();
+    // the buffer may hold a snapshot from two publishes ago, so the stickers are always
+    // rewritten (4 bytes each)
+    m_core.writePackedStickers(s.stickers.data(), s.stickers.size());
+    s.animCount = m_core.layerAnimationCount();
+    for (int i = 0; i < s.animCount; ++i) s.anims[i] = m_core.layerAnimation(i);
+    s.generation = m_publishedGeneration = m_core.generation();
+    s.restGeneration = m_core.restGeneration();
+    s.landedTurns = m_core.landedTurnCount();
+    s.queueDepth = m_publishedQueueDepth = depth;
+    m_snapshots.publish();
+    if (m_publishWake) m_publishWake(m_publishWakeContext);
+}
+
+void SimulationThread::setPublishWakeup(void (*wake)(void* context), void* context)
+{
+    m_publishWake = wake;
+    m_publishWakeContext = context;
+}
+
+void SimulationThread::run()
+{
+    using clock = std::chrono::steady_clock;
+    const auto step = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(m_tickSeconds));
+    // after a long stall (debugger, suspended laptop) resync instead of replaying every missed tick
+    const auto maxLag = step * 8;
+
+    auto next = clock::now();
+    while (m_running.load(std::memory_order_acquire)) {
+        m_core.update((float)m_tickSeconds);
+        publishIfChanged();
+
+        next += step;
+        auto now = clock::now();
+        if (now - next > maxLag) next = now;
+        std::this_thread::sleep_until(next);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef SIM_THREAD_H
+#define SIM_THREAD_H
+
+// SimulationThread - runs Core::update() at a fixed timestep on its own thread
+// - Publishes the resting stickers (4-byte PackedStickers) and the running layer animations
+//   through a lock-free TripleBuffer; the render loop takes the newest snapshot without
+//   waiting, so slow frames / vsync never hold up the simulation
+// - While it runs, the owning thread must only touch Core through its thread-safe members
+//   (submitMove, submitClearQueue, hasPendingSubmissions)
+// Usage:
+//   SimulationThread sim(core, 240.0);
+//   sim.start();
+//   // each frame:
+//   if (sim.fetchSnapshot() && sim.snapshot().restGeneration != uploaded) upload(sim.snapshot().stickers);
+//   // animate sim.snapshot().anims[0..animCount) in the vertex shader
+//   // on exit (or automatically in the destructor):
+//   sim.stop();
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "triple_buffer.h"
+
+struct StickerSnapshot {
+    std::vector<PackedSticker> stickers;                // Core's sticker order, at rest
+    int animCount = 0;                                  // Core::layerAnimationCount()
+    Core::LayerAnimation anims[Core::kMaxActiveTurns];  // Core::layerAnimation(0..animCount)
+    uint64_t generation = 0;                            // Core::generation() when taken
+    uint64_t restGeneration = 0;                        // Core::restGeneration(); stickers only change with it
+    uint64_t landedTurns = 0;                           // Core::landedTurnCount()
+    size_t queueDepth = 0;                              // Core::queuedMoveCount()
+};
+
+class SimulationThread {
+public:
+    // tickHz: simulation steps per second; every step advances Core by exactly 1/tickHz
+    explicit SimulationThread(Core& core, double tickHz = 240.0);
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    void start();
+    void stop();
+    bool running() const;
+
+    // Render thread: switch to the newest published snapshot. Returns true if it is new.
+    bool fetchSnapshot();
+    // Render thread: current snapshot (valid until the next fetchSnapshot()).
+    const StickerSnapshot& snapshot() const;
+
+    // Called on the simulation thread after every publish, e.g. glfwPostEmptyEvent so a render
+    // loop waiting for events sees the new snapshot. Set it before start().
+    void setPublishWakeup(void (*wake)(void* context), void* context);
+
+private:
+    void run();
+    void publishIfChanged();
+
+    Core& m_core;
+    double m_tickSeconds;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    TripleBuffer<StickerSnapshot> m_snapshots;
+    uint64_t m_publishedGeneration = ~0ull; // simulation thread only
+    size_t m_publishedQueueDepth = 0;
+    void (*m_publishWake)(void*) = nullptr;
+    void* m_publishWakeContext = nullptr;
+};
+
+#endif // SIM_THREAD_H
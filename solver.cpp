@@ -0,0 +1,720 @@
+#include "solver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include "mapped_file.h"
+
+namespace {
+
+// coordinate ranges
+const int N_TWIST = 2187;     // 3^7 corner orientations
+const int N_FLIP = 2048;      // 2^11 edge orientations
+const int N_SLICE = 495;      // C(12,4) positions of the FR FL BL BR edges
+const int N_CORNERS = 40320;  // 8! corner permutations
+const int N_UD_EDGES = 40320; // 8! permutations of the U/D-layer edges (phase 2 only)
+const int N_SLICE_PERM = 24;  // 4! permutations of the slice edges (phase 2 only)
+
+const int N_PHASE2_MOVES = 10;
+// phase 2 generators: U, U2, U', D, D2, D', R2, L2, F2, B2
+const Move PHASE2_MOVES[N_PHASE2_MOVES] = {
+    Move::U, Move::U2, Move::Ui, Move::D, Move::D2, Move::Di, Move::R2, Move::L2, Move::F2, Move::B2
+};
+
+const int MAX_PHASE2_DEPTH = 18;
+const int ROOT_PREFIX = 2; // phase-1 moves fixed per work item (243 subtrees of the root)
+const uint8_t UNSET = 0xFF;
+
+int choose(int n, int k)
+{
+    if (k < 0 || k > n) return 0;
+    int r = 1;
+    for (int i = 0; i < k; ++i) r = r * (n - i) / (i + 1);
+    return r;
+}
+
+// Lehmer code of p[0..n) (a permutation of n distinct values), 0 for the sorted order
+int rankPermutation(const uint8_t* p, int n)
+{
+    int idx = 0;
+    for (int i = 0; i < n; ++i) {
+        int smaller = 0;
+        for (int j = i + 1; j < n; ++j) smaller += p[j] < p[i];
+        idx = idx * (n - i) + smaller;
+    }
+    return idx;
+}
+
+// inverse of rankPermutation over the values 0..n-1
+void unrankPermutation(int idx, int n, uint8_t* p)
+{
+    int digits[12];
+    for (int i = n - 1; i >= 0; --i) {
+        digits[i] = idx % (n - i);
+        idx /= (n - i);
+    }
+    uint8_t avail[12];
+    for (int i = 0; i < n; ++i) avail[i] = (uint8_t)i;
+    int left = n;
+    for (int i = 0; i < n; ++i) {
+        p[i] = avail[digits[i]];
+        memmove(avail + digits[i], avail + digits[i] + 1, left - digits[i] - 1);
+        --left;
+    }
+}
+
+int twistOf(const CubieCube& c)
+{
+    int t = 0;
+    for (int i = 0; i < 7; ++i) t = 3 * t + c.co[i];
+    return t;
+}
+
+void setTwist(CubieCube& c, int t)
+{
+    int sum = 0;
+    for (int i = 6; i >= 0; --i) {
+        c.co[i] = (uint8_t)(t % 3);
+        sum += c.co[i];
+        t /= 3;
+    }
+    c.co[7] = (uint8_t)((3 - sum % 3) % 3);
+}
+
+int flipOf(const CubieCube& c)
+{
+    int f = 0;
+    for (int i = 0; i < 11; ++i) f = 2 * f + c.eo[i];
+    return f;
+}
+
+void setFlip(CubieCube& c, int f)
+{
+    int sum = 0;
+    for (int i = 10; i >= 0; --i) {
+        c.eo[i] = (uint8_t)(f & 1);
+        sum += c.eo[i];
+        f >>= 1;
+    }
+    c.eo[11] = (uint8_t)(sum & 1);
+}
+
+// which 4 slots hold the slice edges (8..11), 0 when they are home
+int sliceOf(const CubieCube& c)
+{
+    int a = 0, x = 0;
+    for (int j = 11; j >= 0; --j) {
+        if (c.ep[j] >= 8) {
+            a += choose(11 - j, x + 1);
+            ++x;
+        }
+    }
+    return a;
+}
+
+void setSlice(CubieCube& c, int idx)
+{
+    int x = 4;
+    uint8_t nextSlice = 8, nextOther = 0;
+    for (int j = 0; j < 12; ++j) {
+        if (x > 0 && idx >= choose(11 - j, x)) {
+            idx -= choose(11 - j, x);
+            c.ep[j] = nextSlice++;
+            --x;
+        } else {
+            c.ep[j] = nextOther++;
+        }
+    }
+}
+
+int cornersOf(const CubieCube& c)
+{
+    return rankPermutation(c.cp, 8);
+}
+
+// phase 2 only: the U/D edges sit in slots 0..7 and the slice edges in 8..11
+int udEdgesOf(const CubieCube& c)
+{
+    return rankPermutation(c.ep, 8);
+}
+
+int slicePermOf(const CubieCube& c)
+{
+    uint8_t p[4];
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(c.ep[8 + i] - 8);
+    return rankPermutation(p, 4);
+}
+
+bool isPhase2Move(Move m)
+{
+    int f = moveFace(m);
+    return f == 0 || f == 3 || moveQuarterTurns(m) == 2;
+}
+
+// canonical move order: never the same face twice, and of two commuting opposite faces
+// only U before D, R before L, F before B
+bool allowedAfter(Move m, Move last)
+{
+    int f = moveFace(m), g = moveFace(last);
+    return f != g && f + 3 != g;
+}
+
+// Breadth-first distance table over pairs (a, b) -> a * nb + b, from (0, 0).
+template<class MoveA, class MoveB>
+void buildPruning(uint8_t* table, int na, int nb, int moves, MoveA moveA, MoveB moveB)
+{
+    size_t total = (size_t)na * nb;
+    memset(table, UNSET, total);
+    table[0] = 0;
+    size_t filled = 1;
+    for (uint8_t depth = 0; filled < total && depth < UNSET - 1; ++depth) {
+        size_t before = filled;
+        for (size_t i = 0; i < total; ++i) {
+            if (table[i] != depth) continue;
+            int a = (int)(i / nb), b = (int)(i % nb);
+            for (int m = 0; m < moves; ++m) {
+                size_t j = (size_t)moveA(a, m) * nb + moveB(b, m);
+                if (table[j] == UNSET) {
+                    table[j] = depth + 1;
+                    ++filled;
+                }
+            }
+        }
+        if (filled == before) break;
+    }
+}
+
+// fn(c, m, d): d = c * move m for every coordinate value c built by set(c, coord)
+template<class Set, class Get>
+void buildMoveTable(uint16_t* out, int n, const Move* moves, int moveCount, Set set, Get get)
+{
+    for (int i = 0; i < n; ++i) {
+        CubieCube c;
+        set(c, i);
+        for (int m = 0; m < moveCount; ++m) {
+            CubieCube d = c;
+            d.multiply(CubieCube::moveCube(moves[m]));
+            out[i * moveCount + m] = (uint16_t)get(d);
+        }
+    }
+}
+
+// Section layout shared by the in-memory tables and the cache file: every table starts on a
+// 64-byte boundary after the header, in this order.
+enum Section {
+    TWIST_MOVE, FLIP_MOVE, SLICE_MOVE, CORNER_MOVE, UD_EDGE_MOVE, SLICE_PERM_MOVE,
+    TWIST_SLICE_PRUNE, FLIP_SLICE_PRUNE, CORNER_SLICE_PRUNE, UD_EDGE_SLICE_PRUNE,
+    SECTION_COUNT
+};
+
+const size_t SECTION_BYTES[SECTION_COUNT] = {
+    N_TWIST * kMoveCount * 2, N_FLIP * kMoveCount * 2, N_SLICE * kMoveCount * 2,
+    N_CORNERS * N_PHASE2_MOVES * 2, N_UD_EDGES * N_PHASE2_MOVES * 2, N_SLICE_PERM * N_PHASE2_MOVES * 2,
+    (size_t)N_TWIST * N_SLICE, (size_t)N_FLIP * N_SLICE,
+    (size_t)N_CORNERS * N_SLICE_PERM, (size_t)N_UD_EDGES * N_SLICE_PERM
+};
+
+// Cache file header. Bump TABLE_FILE_VERSION whenever coordinates, move order or layout change.
+const char TABLE_FILE_MAGIC[8] = { 'R', 'C', 'S', 'O', 'L', 'V', 'E', 'R' };
+const uint32_t TABLE_FILE_VERSION = 1;
+const uint32_t TABLE_FILE_ENDIAN = 0x01020304;
+
+struct TableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t sectionOffset[SECTION_COUNT];
+    uint64_t payloadBytes; // everything after the header
+    uint64_t checksum;     // FNV-1a 64 of the payload
+};
+
+size_t headerBytes()
+{
+    return (sizeof(TableFileHeader) + 63) / 64 * 64;
+}
+
+// offsets relative to the start of the payload; returns the payload size
+size_t sectionOffsets(uint64_t offsets[SECTION_COUNT])
+{
+    size_t at = 0;
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        offsets[s] = at;
+        at += (SECTION_BYTES[s] + 63) / 64 * 64;
+    }
+    return at;
+}
+
+uint64_t fnv1a(const uint8_t* p, size_t n)
+{
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+struct Tables {
+    // phase 1 move tables, [coord * 18 + move]
+    const uint16_t *twistMove, *flipMove, *sliceMove;
+    // phase 2 move tables, [coord * N_PHASE2_MOVES + phase-2 move index]
+    const uint16_t *cornerMove, *udEdgeMove, *slicePermMove;
+    // pruning tables: exact distance to solved for the pair of coordinates
+    const uint8_t *twistSlicePrune, *flipSlicePrune;      // phase 1, 18 moves
+    const uint8_t *cornerSlicePrune, *udEdgeSlicePrune;   // phase 2, 10 moves
+
+    std::vector<uint8_t> storage; // header + payload when generated here
+    MappedFile file;              // header + payload when loaded from the cache
+    bool fromCache = false;
+
+    explicit Tables(const std::string& cachePath)
+    {
+        if (!cachePath.empty() && load(cachePath)) return;
+        generate();
+        if (!cachePath.empty()) save(cachePath);
+    }
+
+    void point(const uint8_t* base)
+    {
+        const TableFileHeader* h = (const TableFileHeader*)base;
+        const uint8_t* payload = base + headerBytes();
+        twistMove = (const uint16_t*)(payload + h->sectionOffset[TWIST_MOVE]);
+        flipMove = (const uint16_t*)(payload + h->sectionOffset[FLIP_MOVE]);
+        sliceMove = (const uint16_t*)(payload + h->sectionOffset[SLICE_MOVE]);
+        cornerMove = (const uint16_t*)(payload + h->sectionOffset[CORNER_MOVE]);
+        udEdgeMove = (const uint16_t*)(payload + h->sectionOffset[UD_EDGE_MOVE]);
+        slicePermMove = (const uint16_t*)(payload + h->sectionOffset[SLICE_PERM_MOVE]);
+        twistSlicePrune = payload + h->sectionOffset[TWIST_SLICE_PRUNE];
+        flipSlicePrune = payload + h->sectionOffset[FLIP_SLICE_PRUNE];
+        cornerSlicePrune = payload + h->sectionOffset[CORNER_SLICE_PRUNE];
+        udEdgeSlicePrune = payload + h->sectionOffset[UD_EDGE_SLICE_PRUNE];
+    }
+
+    bool load(const std::string& path)
+    {
+        if (!file.open(path)) return false;
+        // the layout is fixed by this build, so the header must match it exactly
+        TableFileHeader expect = {};
+        memcpy(expect.magic, TABLE_FILE_MAGIC, sizeof(expect.magic));
+        expect.version = TABLE_FILE_VERSION;
+        expect.endian = TABLE_FILE_ENDIAN;
+        expect.payloadBytes = sectionOffsets(expect.sectionOffset);
+
+        const TableFileHeader* h = (const TableFileHeader*)file.data();
+        bool ok = file.size() == headerBytes() + expect.payloadBytes &&
+                  memcmp(h, &expect, offsetof(TableFileHeader, checksum)) == 0 &&
+                  fnv1a(file.data() + headerBytes(), expect.payloadBytes) == h->checksum;
+        if (!ok) {
+            file.close();
+            return false;
+        }
+        point(file.data());
+        fromCache = true;
+        return true;
+    }
+
+    void save(const std::string& path) const
+    {
+        // write beside the target, then rename over it: readers never see a partial file
+        std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return;
+            out.write((const char*)storage.data(), (std::streamsize)storage.size());
+            if (!out) {
+                out.close();
+                std::remove(tmp.c_str());
+                return;
+            }
+        }
+        if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(path.c_str()); // Windows rename doesn't replace
+            if (std::rename(tmp.c_str(), path.c_str()) != 0) std::remove(tmp.c_str());
+        }
+    }
+
+    void generate()
+    {
+        TableFileHeader h = {};
+        memcpy(h.magic, TABLE_FILE_MAGIC, sizeof(h.magic));
+        h.version = TABLE_FILE_VERSION;
+        h.endian = TABLE_FILE_ENDIAN;
+        h.payloadBytes = sectionOffsets(h.sectionOffset);
+        storage.assign(headerBytes() + h.payloadBytes, 0);
+        memcpy(storage.data(), &h, sizeof(h));
+        point(storage.data());
+
+        uint8_t* payload = storage.data() + headerBytes();
+        uint16_t* tw = (uint16_t*)(payload + h.sectionOffset[TWIST_MOVE]);
+        uint16_t* fl = (uint16_t*)(payload + h.sectionOffset[FLIP_MOVE]);
+        uint16_t* sl = (uint16_t*)(payload + h.sectionOffset[SLICE_MOVE]);
+        uint16_t* co = (uint16_t*)(payload + h.sectionOffset[CORNER_MOVE]);
+        uint16_t* ud = (uint16_t*)(payload + h.sectionOffset[UD_EDGE_MOVE]);
+        uint16_t* sp = (uint16_t*)(payload + h.sectionOffset[SLICE_PERM_MOVE]);
+
+        Move all[kMoveCount];
+        for (int m = 0; m < kMoveCount; ++m) all[m] = (Move)m;
+
+        // every table writes only its own section, so they can be built concurrently:
+        // move tables first, then the pruning tables that walk them
+        runConcurrently({
+            [&] { buildMoveTable(tw, N_TWIST, all, kMoveCount, setTwist, twistOf); },
+            [&] { buildMoveTable(fl, N_FLIP, all, kMoveCount, setFlip, flipOf); },
+            [&] { buildMoveTable(sl, N_SLICE, all, kMoveCount, setSlice, sliceOf); },
+            [&] { buildMoveTable(co, N_CORNERS, PHASE2_MOVES, N_PHASE2_MOVES,
+                      [](CubieCube& c, int p) { unrankPermutation(p, 8, c.cp); }, cornersOf); },
+            [&] { buildMoveTable(ud, N_UD_EDGES, PHASE2_MOVES, N_PHASE2_MOVES,
+                      [](CubieCube& c, int p) { unrankPermutation(p, 8, c.ep); }, udEdgesOf); }, // slots 8..11 stay solved
+            [&] { buildMoveTable(sp, N_SLICE_PERM, PHASE2_MOVES, N_PHASE2_MOVES,
+                      [](CubieCube& c, int p) {
+                          uint8_t perm[4];
+                          unrankPermutation(p, 4, perm);
+                          for (int i = 0; i < 4; ++i) c.ep[8 + i] = (uint8_t)(8 + perm[i]);
+                      }, slicePermOf); },
+        });
+        runConcurrently({
+            [&] { buildPruning(payload + h.sectionOffset[TWIST_SLICE_PRUNE], N_TWIST, N_SLICE, kMoveCount,
+                      [tw](int a, int m) { return tw[a * kMoveCount + m]; }, [sl](int b, int m) { return sl[b * kMoveCount + m]; }); },
+            [&] { buildPruning(payload + h.sectionOffset[FLIP_SLICE_PRUNE], N_FLIP, N_SLICE, kMoveCount,
+                      [fl](int a, int m) { return fl[a * kMoveCount + m]; }, [sl](int b, int m) { return sl[b * kMoveCount + m]; }); },
+            [&] { buildPruning(payload + h.sectionOffset[CORNER_SLICE_PRUNE], N_CORNERS, N_SLICE_PERM, N_PHASE2_MOVES,
+                      [co](int a, int m) { return co[a * N_PHASE2_MOVES + m]; }, [sp](int b, int m) { return sp[b * N_PHASE2_MOVES + m]; }); },
+            [&] { buildPruning(payload + h.sectionOffset[UD_EDGE_SLICE_PRUNE], N_UD_EDGES, N_SLICE_PERM, N_PHASE2_MOVES,
+                      [ud](int a, int m) { return ud[a * N_PHASE2_MOVES + m]; }, [sp](int b, int m) { return sp[b * N_PHASE2_MOVES + m]; }); },
+        });
+
+        TableFileHeader* stored = (TableFileHeader*)storage.data();
+        stored->checksum = fnv1a(payload, h.payloadBytes);
+    }
+
+    // one thread per job, the calling thread takes the first
+    static void runConcurrently(std::initializer_list<std::function<void()>> jobs)
+    {
+        std::vector<std::thread> threads;
+        auto it = jobs.begin();
+        for (auto next = it + 1; next != jobs.end(); ++next) threads.emplace_back(*next);
+        (*it)();
+        for (std::thread& t : threads) t.join();
+    }
+};
+
+std::once_flag g_tablesOnce;
+const Tables* g_tables = nullptr;
+
+const Tables& tables(const std::string& cachePath = std::string())
+{
+    // built once per process; later cache paths are ignored
+    std::call_once(g_tablesOnce, [&] { g_tables = new Tables(cachePath); });
+    return *g_tables;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// State shared by all threads of one solve() call.
+struct SharedSearch {
+    SharedSearch(const CubieCube& start, const SolveOptions& options, const std::atomic<bool>* cancel)
+        : t(tables()), start(start), options(options), cancel(cancel),
+          deadline(Clock::now() + std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double, std::milli>(options.timeLimitMs))),
+          bestLength(std::min(options.maxLength, 255) + 1)
+    {
+    }
+
+    const Tables& t;
+    CubieCube start;
+    SolveOptions options;
+    const std::atomic<bool>* cancel;
+    Clock::time_point deadline;
+
+    // best solution so far; bestLength is read without the lock to bound every thread's search
+    std::atomic<int> bestLength;
+    std::mutex bestLock;
+    std::vector<Move> best; // guarded by bestLock
+
+    std::atomic<bool> stop{false};
+    std::atomic<bool> timedOut{false};
+    std::atomic<uint64_t> nodes{0};
+
+    // Work queue of phase-1 subtrees: item i is prefix i % prefixes.size() searched to total
+    // depth firstDepth + i / prefixes.size(), so threads deepen together and pick up the
+    // shallow subtrees first.
+    struct Prefix {
+        Move moves[ROOT_PREFIX];
+        int twist, flip, slice;
+    };
+    std::vector<Prefix> prefixes;
+    int firstDepth = 0;
+    std::atomic<size_t> next{0};
+};
+
+// One thread's view of a solve: its own path and node count over the shared bounds.
+class Search {
+public:
+    explicit Search(SharedSearch& shared) : m_s(shared), m_t(shared.t) {}
+
+    ~Search() { m_s.nodes.fetch_add(m_nodes, std::memory_order_relaxed); }
+
+    // Phase-1 depths shorter than the root prefix, searched from the root on one thread.
+    // Returns true if the whole search is over.
+    bool runShallow(int twist, int flip, int slice, int h)
+    {
+        for (int depth = h; depth < ROOT_PREFIX && depth < bestLength() && !stopped(); ++depth) {
+            if (phase1(twist, flip, slice, 0, depth)) return true;
+        }
+        return stopped();
+    }
+
+    // Pull subtrees off the queue until it runs past the best length or the search stops.
+    void runQueue()
+    {
+        const size_t n = m_s.prefixes.size();
+        while (!stopped()) {
+            size_t i = m_s.next.fetch_add(1, std::memory_order_relaxed);
+            int depth = m_s.firstDepth + (int)(i / n);
+            if (depth >= bestLength()) break;
+            const SharedSearch::Prefix& p = m_s.prefixes[i % n];
+            if (phase1Bound(p.twist, p.flip, p.slice) > depth - ROOT_PREFIX) continue;
+            for (int k = 0; k < ROOT_PREFIX; ++k) m_path[k] = p.moves[k];
+            if (phase1(p.twist, p.flip, p.slice, ROOT_PREFIX, depth - ROOT_PREFIX)) break;
+        }
+    }
+
+    int phase1Bound(int twist, int flip, int slice) const
+    {
+        return std::max(m_t.twistSlicePrune[twist * N_SLICE + slice], m_t.flipSlicePrune[flip * N_SLICE + slice]);
+    }
+
+private:
+    int phase2Bound(int corners, int udEdges, int slicePerm) const
+    {
+        return std::max(m_t.cornerSlicePrune[corners * N_SLICE_PERM + slicePerm],
+                        m_t.udEdgeSlicePrune[udEdges * N_SLICE_PERM + slicePerm]);
+    }
+
+    int bestLength() const { return m_s.bestLength.load(std::memory_order_relaxed); }
+    bool stopped() const { return m_s.stop.load(std::memory_order_relaxed); }
+
+    // true when the whole search should end (target reached, out of time, cancelled)
+    bool tick()
+    {
+        if ((++m_nodes & 0xFFF) != 0) return stopped();
+        if ((m_s.cancel && m_s.cancel->load(std::memory_order_relaxed)) || Clock::now() >= m_s.deadline) {
+            m_s.timedOut.store(true, std::memory_order_relaxed);
+            m_s.stop.store(true, std::memory_order_relaxed);
+        }
+        return stopped();
+    }
+
+    bool phase1(int twist, int flip, int slice, int depth, int togo)
+    {
+        if (togo == 0) {
+            // a phase-1 solution ending in a G1 move would have been found one move earlier
+            if (depth > 0 && isPhase2Move(m_path[depth - 1])) return false;
+            return startPhase2(depth);
+        }
+        for (int mi = 0; mi < kMoveCount; ++mi) {
+            Move m = (Move)mi;
+            if (depth > 0 && !allowedAfter(m, m_path[depth - 1])) continue;
+            int t = m_t.twistMove[twist * kMoveCount + mi];
+            int f = m_t.flipMove[flip * kMoveCount + mi];
+            int s = m_t.sliceMove[slice * kMoveCount + mi];
+            if (phase1Bound(t, f, s) > togo - 1) continue;
+            m_path[depth] = m;
+            if (tick() || phase1(t, f, s, depth + 1, togo - 1)) return true;
+        }
+        return false;
+    }
+
+    bool startPhase2(int phase1Length)
+    {
+        int maxDepth = std::min(bestLength() - 1 - phase1Length, MAX_PHASE2_DEPTH);
+        if (maxDepth < 0) return false;
+
+        CubieCube c = m_s.start;
+        c.applySequence(m_path, phase1Length);
+        int corners = cornersOf(c), udEdges = udEdgesOf(c), slicePerm = slicePermOf(c);
+
+        m_phase1Length = phase1Length;
+        for (int depth = phase2Bound(corners, udEdges, slicePerm); depth <= maxDepth; ++depth) {
+            if (phase2(corners, udEdges, slicePerm, phase1Length, depth)) {
+                recordSolution(phase1Length + depth);
+                return stopped();
+            }
+            if (stopped()) return true;
+        }
+        return false;
+    }
+
+    void recordSolution(int length)
+    {
+        // phase 2 may open with the face phase 1 ended on (R then R2): merge those into one turn
+        int b = m_phase1Length;
+        std::vector<Move> moves(m_path, m_path + length);
+        if (b > 0 && b < length && moveFace(moves[b - 1]) == moveFace(moves[b])) {
+            int qt = (moveQuarterTurns(moves[b - 1]) + moveQuarterTurns(moves[b])) & 3;
+            moves.erase(moves.begin() + b);
+            if (qt) moves[b - 1] = makeMove(moveFace(moves[b - 1]), qt);
+            else moves.erase(moves.begin() + (b - 1));
+        }
+        std::lock_guard<std::mutex> lock(m_s.bestLock);
+        if ((int)moves.size() >= m_s.bestLength.load(std::memory_order_relaxed)) return;
+        m_s.bestLength.store((int)moves.size(), std::memory_order_relaxed);
+        m_s.best.swap(moves);
+        if ((int)m_s.best.size() <= m_s.options.targetLength) m_s.stop.store(true, std::memory_order_relaxed);
+    }
+
+    bool phase2(int corners, int udEdges, int slicePerm, int depth, int togo)
+    {
+        if (togo == 0) return true; // bound 0 means solved
+        for (int mi = 0; mi < N_PHASE2_MOVES; ++mi) {
+            Move m = PHASE2_MOVES[mi];
+            if (depth > 0 && !allowedAfter(m, m_path[depth - 1])) {
+                // except right after phase 1, where a same-face turn is merged (recordSolution)
+                if (depth != m_phase1Length || moveFace(m) != moveFace(m_path[depth - 1])) continue;
+            }
+            int c = m_t.cornerMove[corners * N_PHASE2_MOVES + mi];
+            int u = m_t.udEdgeMove[udEdges * N_PHASE2_MOVES + mi];
+            int s = m_t.slicePermMove[slicePerm * N_PHASE2_MOVES + mi];
+            if (phase2Bound(c, u, s) > togo - 1) continue;
+            m_path[depth] = m;
+            if (tick()) return false;
+            if (phase2(c, u, s, depth + 1, togo - 1)) return true;
+        }
+        return false;
+    }
+
+    SharedSearch& m_s;
+    const Tables& m_t;
+
+    Move m_path[256];
+    int m_phase1Length = 0;
+    uint64_t m_nodes = 0;
+};
+
+void runSearch(SharedSearch& shared, unsigned threads, SolveResult& result)
+{
+    const Tables& t = shared.t;
+    int twist = twistOf(shared.start), flip = flipOf(shared.start), slice = sliceOf(shared.start);
+
+    bool done;
+    int h;
+    {
+        Search root(shared);
+        h = root.phase1Bound(twist, flip, slice);
+        done = root.runShallow(twist, flip, slice, h);
+    }
+
+    if (!done) {
+        // every move sequence of ROOT_PREFIX moves the search itself would try
+        Move prefix[ROOT_PREFIX];
+        std::function<void(int, int, int, int)> expand = [&](int depth, int tw, int fl, int sl) {
+            if (depth == ROOT_PREFIX) {
+                SharedSearch::Prefix p;
+                for (int k = 0; k < ROOT_PREFIX; ++k) p.moves[k] = prefix[k];
+                p.twist = tw;
+                p.flip = fl;
+                p.slice = sl;
+                shared.prefixes.push_back(p);
+                return;
+            }
+            for (int mi = 0; mi < kMoveCount; ++mi) {
+                if (depth > 0 && !allowedAfter((Move)mi, prefix[depth - 1])) continue;
+                prefix[depth] = (Move)mi;
+                expand(depth + 1, t.twistMove[tw * kMoveCount + mi], t.flipMove[fl * kMoveCount + mi],
+                       t.sliceMove[sl * kMoveCount + mi]);
+            }
+        };
+        expand(0, twist, flip, slice);
+        shared.firstDepth = std::max(h, ROOT_PREFIX);
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back([&shared] { Search(shared).runQueue(); });
+        }
+        Search(shared).runQueue();
+        for (std::thread& w : workers) w.join();
+    }
+
+    result.solved = !shared.best.empty();
+    result.moves = shared.best;
+    result.nodes = shared.nodes.load(std::memory_order_relaxed);
+    result.timedOut = shared.timedOut.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void Solver::prepare()
+{
+    tables();
+}
+
+bool Solver::prepare(const std::string& cachePath)
+{
+    return tables(cachePath).fromCache;
+}
+
+SolveResult Solver::solve(const CubieCube& state, const SolveOptions& options, const std::atomic<bool>* cancel)
+{
+    SolveResult result;
+    if (!state.isValid() || options.maxLength < 0) return result;
+    if (state.isSolved()) {
+        result.solved = true;
+        return result;
+    }
+
+    Clock::time_point t0 = Clock::now();
+    unsigned threads = options.threads > 0 ? (unsigned)options.threads : std::thread::hardware_concurrency();
+    SharedSearch shared(state, options, cancel);
+    runSearch(shared, std::max(threads, 1u), result);
+    result.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    return result;
+}
+
+BackgroundSolver::~BackgroundSolver()
+{
+    cancel();
+    wait();
+}
+
+void BackgroundSolver::start(const CubieCube& state, const SolveOptions& options)
+{
+    cancel();
+    wait();
+    m_cancel.store(false, std::memory_order_relaxed);
+    m_done.store(false, std::memory_order_relaxed);
+    m_started = true;
+    m_thread = std::thread([this, state, options] {
+        m_result = Solver::solve(state, options, &m_cancel);
+        m_done.store(true, std::memory_order_release);
+    });
+}
+
+void BackgroundSolver::cancel()
+{
+    m_cancel.store(true, std::memory_order_relaxed);
+}
+
+void BackgroundSolver::wait()
+{
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool BackgroundSolver::busy() const
+{
+    return m_started && !m_done.load(std::memory_order_acquire);
+}
+
+bool BackgroundSolver::tryGetResult(SolveResult& out)
+{
+    if (!m_started || !m_done.load(std::memory_order_acquire)) return false;
+    wait();
+    out = std::move(m_result);
+    m_started = false;
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+// Solver - two-phase (Kociemba) 3x3 solver on top of CubieCube
+// - Phase 1 brings the cube into G1 = <U, D, R2, L2, F2, B2> (no twisted corners, no flipped
+//   edges, middle-slice edges in the middle slice); phase 2 solves it inside G1
+// - Both phases are IDA* over coordinate move tables, bounded by pruning tables that store the
+//   exact distance in a pair of coordinates (twist x slice, flip x slice, corners x slice
+//   permutation, U/D edges x slice permutation)
+// - Keeps searching longer phase-1 prefixes for shorter totals until the solution is at most
+//   targetLength moves, the time budget runs out, or the search is cancelled; returns the best
+//   solution found
+// - The root is split into two-move phase-1 subtrees handed out in order of search depth, so
+//   all threads deepen together; they share the best length found so far as a bound, and all
+//   stop as soon as one of them reaches targetLength
+// - Tables (~7 MB) are built once per process on first use (or by prepare()) and shared by all
+//   threads; solve() itself is reentrant
+// - prepare(cachePath) maps a previously written table file read-only instead of building;
+//   the file is versioned and checksummed, and rewritten (built in parallel) if it is missing,
+//   stale or corrupt
+// Usage:
+//   Solver::prepare("solver_tables.bin");    // optional, at startup
+//   if (core.hasCubieState() && !core.isAnimating() && core.queuedMoveCount() == 0) {
+//       SolveResult r = Solver::solve(core.cubieState());
+//       for (Move m : r.moves) core.queueMove(m);
+//   }
+//   // or off the calling thread:
+//   BackgroundSolver bg;
+//   bg.start(core.cubieState());
+//   SolveResult r;
+//   if (bg.tryGetResult(r)) { ... }
+//
+// No GL and no GLM here.
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cubie.h"
+#include "move.h"
+
+struct SolveOptions {
+    int maxLength = 24;        // never return a longer solution
+    int targetLength = 20;     // stop as soon as a solution this short is found
+    double timeLimitMs = 50.0; // stop searching after this long (returns the best so far)
+    int threads = 0;           // search threads; 0 = std::thread::hardware_concurrency(), 1 = this thread only
+};
+
+struct SolveResult {
+    bool solved = false;     // moves holds a solution (empty if the cube was already solved)
+    bool timedOut = false;   // stopped by the time limit or cancellation
+    std::vector<Move> moves; // pass to Core::queueMove() / applySequence() in order
+    uint64_t nodes = 0;      // search nodes visited
+    double elapsedMs = 0.0;
+};
+
+class Solver {
+public:
+    // Build the move/pruning tables now instead of on the first solve (thread-safe).
+    static void prepare();
+    // Same, but load the tables from `cachePath` if it holds a valid table file, otherwise build
+    // them and write the file for next time. Returns true if they came from the file. Only the
+    // first prepare()/solve() in a process decides where the tables come from.
+    static bool prepare(const std::string& cachePath);
+
+    // Solve `state`. Returns solved = false if the state is invalid, nothing within maxLength
+    // exists, or the time limit / cancel flag stopped the search before any solution was found.
+    static SolveResult solve(const CubieCube& state, const SolveOptions& options = SolveOptions(),
+                             const std::atomic<bool>* cancel = nullptr);
+};
+
+// Runs one Solver::solve() at a time on its own thread.
+class BackgroundSolver {
+public:
+    BackgroundSolver() = default;
+    ~BackgroundSolver();
+
+    BackgroundSolver(const BackgroundSolver&) = delete;
+    BackgroundSolver& operator=(const BackgroundSolver&) = delete;
+
+    // Cancels any running solve first.
+    void start(const CubieCube& state, const SolveOptions& options = SolveOptions());
+    // Ask the running solve to stop; it still produces a result (the best found so far).
+    void cancel();
+    // Block until the running solve (if any) has finished.
+    void wait();
+
+    bool busy() const;
+    // True once per finished solve: moves the result into `out`.
+    bool tryGetResult(SolveResult& out);
+
+private:
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_done{false};
+    bool m_started = false;
+    SolveResult m_result; // written by the worker before m_done is set
+};
+
+#endif // SOLVER_H
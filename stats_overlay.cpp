@@ -0,0 +1,312 @@
+#include "stats_overlay.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+static const char* overlayVertexSrc = R"glsl(
+#version 330 core
+layout(location = 0) in vec2 aCorner; // unit quad, 0..1
+layout(location = 1) in vec4 aRect;   // per-instance: x, y, width, height in pixels, y down
+layout(location = 2) in vec4 aColor;  // per-instance
+
+uniform vec2 uViewport;
+
+out vec4 vColor;
+
+void main() {
+    vColor = aColor;
+    vec2 px = aRect.xy + aCorner * aRect.zw;
+    gl_Position = vec4(px.x / uViewport.x * 2.0 - 1.0, 1.0 - px.y / uViewport.y * 2.0, 0.0, 1.0);
+}
+)glsl";
+
+static const char* overlayFragmentSrc = R"glsl(
+#version 330 core
+in vec4 vColor;
+out vec4 FragColor;
+void main() {
+    FragColor = vColor;
+}
+)glsl";
+
+namespace {
+
+const float FONT_PX = 2.0f;               // screen pixels per font pixel
+const float ADVANCE = 4.0f * FONT_PX;     // 3 wide + 1 space
+const float LINE_HEIGHT = 7.0f * FONT_PX; // 5 high + 2 space
+const float MARGIN = 8.0f;
+const float PADDING = 6.0f;
+const size_t GRAPH_FRAMES = 120;
+const float BAR_WIDTH = 2.0f;
+const float GRAPH_HEIGHT = 64.0f;         // twice the budget
+const double TEXT_INTERVAL = 0.5;
+
+const glm::vec4 PANEL_COLOR(0.0f, 0.0f, 0.0f, 0.6f);
+const glm::vec4 TEXT_COLOR(0.92f, 0.92f, 0.92f, 1.0f);
+const glm::vec4 BAR_COLOR(0.3f, 0.8f, 0.35f, 0.9f);
+const glm::vec4 OVER_COLOR(0.9f, 0.25f, 0.2f, 0.9f);
+const glm::vec4 BUDGET_COLOR(1.0f, 0.85f, 0.2f, 0.9f);
+
+// 3x5 glyphs, rows top to bottom, '1' = lit
+const char* glyph(char c)
+{
+    switch (c) {
+    case '0': return "111101101101111";
+    case '1': return "010110010010111";
+    case '2': return "111001111100111";
+    case '3': return "111001111001111";
+    case '4': return "101101111001001";
+    case '5': return "111100111001111";
+    case '6': return "111100111101111";
+    case '7': return "111001001001001";
+    case '8': return "111101111101111";
+    case '9': return "111101111001111";
+    case 'A': return "010101111101101";
+    case 'B': return "110101110101110";
+    case 'C': return "011100100100011";
+    case 'D': return "110101101101110";
+    case 'E': return "111100110100111";
+    case 'F': return "111100110100100";
+    case 'G': return "011100101101011";
+    case 'H': return "101101111101101";
+    case 'I': return "111010010010111";
+    case 'J': return "001001001101010";
+    case 'K': return "101101110101101";
+    case 'L': return "100100100100111";
+    case 'M': return "101111111101101";
+    case 'N': return "110101101101101";
+    case 'O': return "010101101101010";
+    case 'P': return "110101110100100";
+    case 'Q': return "010101101110011";
+    case 'R': return "110101110101101";
+    case 'S': return "011100010001110";
+    case 'T': return "111010010010010";
+    case 'U': return "101101101101111";
+    case 'V': return "101101101101010";
+    case 'W': return "101101111111101";
+    case 'X': return "101101010101101";
+    case 'Y': return "101101010010010";
+    case 'Z': return "111001010100111";
+    case '.': return "000000000000010";
+    case ':': return "000010000010000";
+    case '/': return "001001010100100";
+    case '%': return "101001010100101";
+    case '-': return "000000111000000";
+    default: return nullptr; // blank
+    }
+}
+
+GLuint compileStage(GLenum type, const char* src)
+{
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, nullptr);
+    glCompileShader(s);
+    GLint ok; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetShaderInfoLog(s, len, nullptr, &log[0]);
+        std::cerr << "Overlay shader compile error: " << log << std::endl;
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+GLuint linkOverlayProgram()
+{
+    GLuint vs = compileStage(GL_VERTEX_SHADER, overlayVertexSrc);
+    GLuint fs = compileStage(GL_FRAGMENT_SHADER, overlayFragmentSrc);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint prog = glCreateProgram();
+    glAttachShader(prog, vs);
+    glAttachShader(prog, fs);
+    glLinkProgram(prog);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok; glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len; glGetProgramiv(prog, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(prog, len, nullptr, &log[0]);
+        std::cerr << "Overlay program link error: " << log << std::endl;
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+std::string format(const char* fmt, double a, double b = 0.0, double c = 0.0)
+{
+    char buf[96];
+    std::snprintf(buf, sizeof(buf), fmt, a, b, c);
+    return buf;
+}
+
+} // namespace
+
+bool StatsOverlay::create()
+{
+    destroy();
+    m_program = linkOverlayProgram();
+    if (!m_program) return false;
+    m_locViewport = glGetUniformLocation(m_program, "uViewport");
+
+    const float corners[] = {
+        0.0f, 0.0f,   1.0f, 0.0f,   1.0f, 1.0f,
+        0.0f, 0.0f,   1.0f, 1.0f,   0.0f, 1.0f
+    };
+    glGenVertexArrays(1, &m_vao);
+    glGenBuffers(1, &m_quadVbo);
+    glGenBuffers(1, &m_instanceVbo);
+
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Rect), (void*)offsetof(Rect, rect));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Rect), (void*)offsetof(Rect, color));
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_lastTextUpdate = -1.0e9;
+    return true;
+}
+
+void StatsOverlay::destroy()
+{
+    if (m_program) glDeleteProgram(m_program);
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    GLuint buffers[] = { m_quadVbo, m_instanceVbo };
+    for (GLuint b : buffers) {
+        if (b) glDeleteBuffers(1, &b);
+    }
+    m_program = m_vao = m_quadVbo = m_instanceVbo = 0;
+}
+
+void StatsOverlay::rebuildText(const FrameProfiler& profiler)
+{
+    FrameStats st = profiler.stats();
+    m_lines.clear();
+    m_lines.push_back(format("FRAME   P50 %5.2f  P99 %5.2f  MAX %5.2f MS", st.frameMs.p50, st.frameMs.p99, st.frameMs.max));
+    if (st.gpuFrames > 0)
+        m_lines.push_back(format("GPU     P50 %5.2f  P99 %5.2f  MAX %5.2f MS", st.gpuMs.p50, st.gpuMs.p99, st.gpuMs.max));
+    else
+        m_lines.push_back("GPU     -");
+    for (int k = 0; k < profiler.sectionCount(); ++k) {
+        std::string name = profiler.sectionName(k).substr(0, 7);
+        name.resize(8, ' ');
+        const Percentiles& p = st.sectionMs[k];
+        m_lines.push_back(name + format("P50 %5.2f  P99 %5.2f  MAX %5.2f MS", p.p50, p.p99, p.max));
+    }
+    m_lines.push_back(format("MOVES/S %.1f   QUEUE P50 %.0f  MAX %.0f", st.movesPerSecond, st.queueDepth.p50, st.queueDepth.max));
+
+    std::vector<float> times(st.frames);
+    size_t n = profiler.recentFrameTimes(times.data(), times.size());
+    size_t over = (size_t)std::count_if(times.begin(), times.begin() + n, [&](float ms) { return ms > m_budgetMs; });
+    m_lines.push_back(format("BUDGET %.1f MS   OVER %.1f%% OF %.0f FRAMES", m_budgetMs,
+                             n ? 100.0 * over / n : 0.0, (double)n));
+
+    m_textRects.clear();
+    float y = MARGIN + PADDING;
+    for (const std::string& line : m_lines) {
+        addText(MARGIN + PADDING, y, line, TEXT_COLOR);
+        y += LINE_HEIGHT;
+    }
+}
+
+void StatsOverlay::addText(float x, float y, const std::string& text, const glm::vec4& color)
+{
+    for (char c : text) {
+        const char* g = glyph((char)std::toupper((unsigned char)c));
+        if (g) {
+            // one rect per horizontal run of lit pixels
+            for (int row = 0; row < 5; ++row) {
+                for (int col = 0; col < 3;) {
+                    if (g[row * 3 + col] != '1') { ++col; continue; }
+                    int end = col;
+                    while (end < 3 && g[row * 3 + end] == '1') ++end;
+                    Rect r;
+                    r.rect = glm::vec4(x + col * FONT_PX, y + row * FONT_PX, (end - col) * FONT_PX, FONT_PX);
+                    r.color = color;
+                    m_textRects.push_back(r);
+                    col = end;
+                }
+            }
+        }
+        x += ADVANCE;
+    }
+}
+
+void StatsOverlay::update(const FrameProfiler& profiler, double nowSeconds)
+{
+    if (!m_visible) return;
+    if (nowSeconds - m_lastTextUpdate >= TEXT_INTERVAL) {
+        rebuildText(profiler);
+        m_lastTextUpdate = nowSeconds;
+    }
+
+    m_history.resize(GRAPH_FRAMES);
+    m_history.resize(profiler.recentFrameTimes(m_history.data(), GRAPH_FRAMES));
+
+    size_t longest = 0;
+    for (const std::string& line : m_lines) longest = std::max(longest, line.size());
+    float textHeight = m_lines.size() * LINE_HEIGHT;
+    float panelWidth = std::max(longest * ADVANCE, GRAPH_FRAMES * BAR_WIDTH) + 2.0f * PADDING;
+    float panelHeight = textHeight + GRAPH_HEIGHT + 3.0f * PADDING;
+    float graphLeft = MARGIN + PADDING;
+    float graphBottom = MARGIN + panelHeight - PADDING;
+
+    m_rects.clear();
+    m_rects.push_back(Rect{ glm::vec4(MARGIN, MARGIN, panelWidth, panelHeight), PANEL_COLOR });
+    // bars right-aligned, newest frame last
+    float x = graphLeft + (GRAPH_FRAMES - m_history.size()) * BAR_WIDTH;
+    for (float ms : m_history) {
+        float h = std::min(ms / (2.0f * m_budgetMs), 1.0f) * GRAPH_HEIGHT;
+        m_rects.push_back(Rect{ glm::vec4(x, graphBottom - h, BAR_WIDTH, h), ms > m_budgetMs ? OVER_COLOR : BAR_COLOR });
+        x += BAR_WIDTH;
+    }
+    m_rects.push_back(Rect{ glm::vec4(graphLeft, graphBottom - 0.5f * GRAPH_HEIGHT, GRAPH_FRAMES * BAR_WIDTH, 1.0f), BUDGET_COLOR });
+    m_rects.insert(m_rects.end(), m_textRects.begin(), m_textRects.end());
+}
+
+void StatsOverlay::draw(int framebufferWidth, int framebufferHeight)
+{
+    if (!m_visible || !m_program || m_rects.empty() || framebufferWidth <= 0 || framebufferHeight <= 0) return;
+
+    GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // a few hundred rects: orphan and refill every frame
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, m_rects.size() * sizeof(Rect), m_rects.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glUseProgram(m_program);
+    glUniform2f(m_locViewport, (float)framebufferWidth, (float)framebufferHeight);
+    glBindVertexArray(m_vao);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)m_rects.size());
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    if (!blend) glDisable(GL_BLEND);
+    if (depth) glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,73 @@
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+// StatsOverlay - on-screen frame statistics from a FrameProfiler
+// - Text (built-in 3x5 pixel font, upper case, digits and . : / % -): frame time p50/p99/max,
+//   GPU draw time, every profiler section, moves/sec, queue depth and the share of frames
+//   over budget; rebuilt twice a second so it stays readable
+// - A bar graph of the last frames' times with the budget line at half its height; bars
+//   over budget are red
+// - Everything is pixel-space rectangles (one per run of lit font pixels) drawn with one
+//   instanced draw, blended, without depth test
+// Usage:
+//   StatsOverlay overlay;
+//   if (!overlay.create()) { /* shader error */ }
+//   // each frame, after the scene:
+//   overlay.update(profiler, glfwGetTime());
+//   overlay.draw(fbWidth, fbHeight);
+//   // at exit, with the context current:
+//   overlay.destroy();
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "frame_profiler.h"
+
+class StatsOverlay {
+public:
+    StatsOverlay() = default;
+    StatsOverlay(const StatsOverlay&) = delete;
+    StatsOverlay& operator=(const StatsOverlay&) = delete;
+
+    // Compiles the overlay shader and creates the buffers. Returns false on a shader error.
+    bool create();
+    // Needs the GL context that created the objects to be current.
+    void destroy();
+
+    void setVisible(bool visible) { m_visible = visible; }
+    bool visible() const { return m_visible; }
+    // Frame time budget in ms (default 1000/60).
+    void setBudgetMs(float ms) { m_budgetMs = ms; }
+
+    // Refresh from the profiler: the graph every call, the text when half a second has
+    // passed since the last refresh (nowSeconds: any monotonic clock).
+    void update(const FrameProfiler& profiler, double nowSeconds);
+    // Draw in the top-left corner. Leaves blending and the depth test as it found them.
+    void draw(int framebufferWidth, int framebufferHeight);
+
+private:
+    struct Rect {
+        glm::vec4 rect;  // x, y, width, height in pixels from the top-left corner
+        glm::vec4 color;
+    };
+
+    void rebuildText(const FrameProfiler& profiler);
+    void addText(float x, float y, const std::string& text, const glm::vec4& color);
+
+    GLuint m_program = 0;
+    GLuint m_vao = 0;
+    GLuint m_quadVbo = 0;
+    GLuint m_instanceVbo = 0;
+    GLint m_locViewport = -1;
+    bool m_visible = true;
+    float m_budgetMs = 1000.0f / 60.0f;
+
+    double m_lastTextUpdate = -1.0e9;
+    std::vector<std::string> m_lines;
+    std::vector<Rect> m_textRects;     // m_lines, laid out
+    std::vector<Rect> m_rects;         // panel + graph + text, as uploaded
+    std::vector<float> m_history;      // recent frame times for the graph
+};
+
+#endif // STATS_OVERLAY_H
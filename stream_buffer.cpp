@@ -0,0 +1,71 @@
+#include "stream_buffer.h"
+
+bool StreamBuffer::create(GLenum target, size_t regionBytes)
+{
+    destroy();
+    if (!GLAD_GL_ARB_buffer_storage) return false;
+
+    // keep every region start aligned for attribute offsets
+    const size_t align = 256;
+    m_regionBytes = (regionBytes + align - 1) / align * align;
+    m_target = target;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(target, m_buffer);
+    glBufferStorage(target, (GLsizeiptr)(m_regionBytes * REGIONS), nullptr, flags);
+    m_ptr = (uint8_t*)glMapBufferRange(target, 0, (GLsizeiptr)(m_regionBytes * REGIONS), flags);
+    glBindBuffer(target, 0);
+
+    if (!m_ptr) {
+        destroy();
+        return false;
+    }
+    m_region = REGIONS - 1; // first beginWrite() lands in region 0
+    return true;
+}
+
+void StreamBuffer::destroy()
+{
+    for (GLsync& f : m_fences) {
+        if (f) glDeleteSync(f);
+        f = nullptr;
+    }
+    if (m_buffer) {
+        if (m_ptr) {
+            glBindBuffer(m_target, m_buffer);
+            glUnmapBuffer(m_target);
+            glBindBuffer(m_target, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+    m_buffer = 0;
+    m_ptr = nullptr;
+}
+
+void StreamBuffer::waitFence(int region)
+{
+    GLsync& f = m_fences[region];
+    if (!f) return;
+    for (;;) {
+        GLenum r = glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms slices
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED || r == GL_WAIT_FAILED) break;
+    }
+    glDeleteSync(f);
+    f = nullptr;
+}
+
+void* StreamBuffer::beginWrite()
+{
+    m_region = (m_region + 1) % REGIONS;
+    waitFence(m_region);
+    return m_ptr + regionOffset();
+}
+
+void StreamBuffer::fence()
+{
+    // re-fence every frame the region is drawn from, not just the frame it was written
+    GLsync& f = m_fences[m_region];
+    if (f) glDeleteSync(f);
+    f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
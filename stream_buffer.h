@@ -0,0 +1,57 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+// StreamBuffer - persistently mapped, triple-buffered GL buffer for per-frame streaming
+// - One buffer object created with glBufferStorage (GL 4.4 / GL_ARB_buffer_storage) and mapped
+//   once with MAP_PERSISTENT | MAP_COHERENT, split into three regions
+// - beginWrite() moves to the next region and waits on that region's fence, so the CPU never
+//   overwrites data the GPU may still read; callers write straight into the returned pointer
+//   (no staging copy, no glBufferSubData, no implicit driver sync)
+// - fence() after issuing the draws that read the current region
+// - Requires a glad loader generated with the GL_ARB_buffer_storage extension
+// Usage:
+//   StreamBuffer s;
+//   if (s.create(GL_ARRAY_BUFFER, bytesPerFrame)) {
+//       void* dst = s.beginWrite();  // fill dst
+//       // point attributes at s.buffer() + s.regionOffset(), draw
+//       s.fence();
+//   }
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+
+class StreamBuffer {
+public:
+    static const int REGIONS = 3;
+
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Returns false (and leaves the object unmapped) if persistent mapping is unavailable.
+    bool create(GLenum target, size_t regionBytes);
+    // Needs the GL context that created the buffer to be current.
+    void destroy();
+
+    bool mapped() const { return m_ptr != nullptr; }
+    GLuint buffer() const { return m_buffer; }
+    size_t regionBytes() const { return m_regionBytes; }
+
+    void* beginWrite();
+    int region() const { return m_region; } // 0..REGIONS-1, the one beginWrite() last returned
+    size_t regionOffset() const { return (size_t)m_region * m_regionBytes; }
+    void fence();
+
+private:
+    void waitFence(int region);
+
+    GLenum m_target = 0;
+    GLuint m_buffer = 0;
+    uint8_t* m_ptr = nullptr;
+    size_t m_regionBytes = 0;
+    int m_region = 0;
+    GLsync m_fences[REGIONS] = {};
+};
+
+#endif // STREAM_BUFFER_H
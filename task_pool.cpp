@@ -0,0 +1,123 @@
+#include "task_pool.h"
+
+#include <algorithm>
+
+TaskPool::TaskPool(unsigned threads)
+{
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i) m_workers.emplace_back(new Worker());
+    for (unsigned i = 1; i < threads; ++i) m_threads.emplace_back(&TaskPool::workerMain, this, i);
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_wakeLock);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& t : m_threads) t.join();
+}
+
+void TaskPool::run(size_t count, size_t grain, const void* ctx, void (*invoke)(const void*, size_t, size_t))
+{
+    Job job;
+    job.ctx = ctx;
+    job.invoke = invoke;
+    job.grain = std::max<size_t>(grain, 1);
+    job.remaining.store(count, std::memory_order_relaxed);
+
+    // small loops (or a single worker) aren't worth waking anyone for
+    unsigned workers = (unsigned)m_workers.size();
+    if (workers == 1 || count <= job.grain) {
+        invoke(ctx, 0, count);
+        return;
+    }
+
+    // seed every deque with an even share so most workers start without stealing
+    for (unsigned i = 0; i < workers; ++i) {
+        size_t b = count * i / workers, e = count * (i + 1) / workers;
+        if (b == e) continue;
+        std::lock_guard<std::mutex> guard(m_workers[i]->lock);
+        m_workers[i]->ranges.push_back({ b, e });
+    }
+
+    m_busy.store(workers - 1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> guard(m_wakeLock);
+        m_job = &job;
+        ++m_jobSerial;
+    }
+    m_wake.notify_all();
+
+    work(0, job);
+
+    // `job` lives on this stack frame: wait until every worker has let go of it
+    while (m_busy.load(std::memory_order_acquire) != 0) std::this_thread::yield();
+    std::lock_guard<std::mutex> guard(m_wakeLock);
+    m_job = nullptr;
+}
+
+void TaskPool::workerMain(unsigned index)
+{
+    uint64_t seen = 0;
+    for (;;) {
+        Job* job = nullptr;
+        {
+            std::unique_lock<std::mutex> guard(m_wakeLock);
+            m_wake.wait(guard, [&] { return m_stop || m_jobSerial != seen; });
+            if (m_stop) return;
+            seen = m_jobSerial;
+            job = m_job;
+        }
+        if (job) work(index, *job);
+        m_busy.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void TaskPool::work(unsigned index, Job& job)
+{
+    Range r;
+    while (job.remaining.load(std::memory_order_acquire) != 0) {
+        if (!popLocal(index, r) && !steal(index, r)) {
+            // everything left is being processed by others
+            std::this_thread::yield();
+            continue;
+        }
+        // split down to grain size, keeping the upper halves available to thieves
+        while (r.end - r.begin > job.grain) {
+            size_t mid = r.begin + (r.end - r.begin) / 2;
+            {
+                std::lock_guard<std::mutex> guard(m_workers[index]->lock);
+                m_workers[index]->ranges.push_back({ mid, r.end });
+            }
+            r.end = mid;
+        }
+        job.invoke(job.ctx, r.begin, r.end);
+        job.remaining.fetch_sub(r.end - r.begin, std::memory_order_acq_rel);
+    }
+}
+
+bool TaskPool::popLocal(unsigned index, Range& out)
+{
+    Worker& w = *m_workers[index];
+    std::lock_guard<std::mutex> guard(w.lock);
+    if (w.ranges.empty()) return false;
+    out = w.ranges.back();
+    w.ranges.pop_back();
+    return true;
+}
+
+bool TaskPool::steal(unsigned index, Range& out)
+{
+    unsigned n = (unsigned)m_workers.size();
+    for (unsigned k = 1; k < n; ++k) {
+        Worker& victim = *m_workers[(index + k) % n];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.ranges.empty()) continue;
+        out = victim.ranges.front();
+        victim.ranges.pop_front();
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,85 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+// TaskPool - fixed set of worker threads running data-parallel loops with work stealing
+// - parallelFor(count, grain, fn) calls fn(begin, end) over disjoint ranges covering [0, count)
+//   and returns when all of them are done; the calling thread works too
+// - Each worker owns a deque of ranges, seeded with an even share. A worker splits its range
+//   in half until it is at most `grain` long, keeping the upper halves on its own deque (LIFO,
+//   cache-warm); an idle worker steals the oldest, largest range from another worker's deque
+//   (FIFO), so uneven items (big and small cubes) still balance
+// - Workers sleep on a condition variable between loops
+// - One loop at a time: parallelFor must not be called from inside fn or from two threads
+// Usage:
+//   TaskPool pool;                              // hardware_concurrency() workers
+//   pool.parallelFor(cubes.size(), 16, [&](size_t b, size_t e) {
+//       for (size_t i = b; i < e; ++i) cubes[i].update(dt);
+//   });
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <memory>
+
+class TaskPool {
+public:
+    // threads: total workers including the calling thread; 0 = std::thread::hardware_concurrency()
+    explicit TaskPool(unsigned threads = 0);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    unsigned workerCount() const { return (unsigned)m_workers.size(); }
+
+    template<class Fn>
+    void parallelFor(size_t count, size_t grain, Fn&& fn)
+    {
+        if (count == 0) return;
+        using Body = typename std::remove_reference<Fn>::type;
+        auto invoke = [](const void* ctx, size_t b, size_t e) { (*(Body*)ctx)(b, e); };
+        run(count, grain, (const void*)&fn, invoke);
+    }
+
+private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex lock;
+        std::deque<Range> ranges; // owner: back, thieves: front
+    };
+
+    struct Job {
+        const void* ctx = nullptr;
+        void (*invoke)(const void*, size_t, size_t) = nullptr;
+        size_t grain = 1;
+        std::atomic<size_t> remaining{0}; // items not yet processed
+    };
+
+    void run(size_t count, size_t grain, const void* ctx, void (*invoke)(const void*, size_t, size_t));
+    void workerMain(unsigned index);
+    void work(unsigned index, Job& job);
+    bool popLocal(unsigned index, Range& out);
+    bool steal(unsigned index, Range& out);
+
+    std::vector<std::unique_ptr<Worker>> m_workers; // [0] belongs to the calling thread
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_wakeLock;
+    std::condition_variable m_wake;
+    Job* m_job = nullptr;        // guarded by m_wakeLock
+    uint64_t m_jobSerial = 0;    // guarded by m_wakeLock; bumped per parallelFor
+    bool m_stop = false;         // guarded by m_wakeLock
+    std::atomic<unsigned> m_busy{0}; // workers that still hold a reference to the current job
+};
+
+#endif // TASK_POOL_H
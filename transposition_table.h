@@ -0,0 +1,82 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+// TranspositionTable - bounded lock-free map from 64-bit state hashes to 64-bit values
+// - Fixed number of slots (rounded up to a power of two), indexed by the low hash bits; a
+//   store simply overwrites whatever held its slot, so memory never grows
+// - Any number of threads may probe() and store() concurrently without locks: each slot keeps
+//   (key ^ value, value), and a probe only hits if the two halves agree, so a slot torn by two
+//   racing stores reads as a miss instead of a wrong value
+// - Lossy by design: a stored entry can be evicted at any time, so callers must treat a miss
+//   as "unknown", never as "absent"
+// Usage:
+//   TranspositionTable seen(1 << 20);
+//   uint64_t h = core.stateHash(), v;
+//   if (seen.probe(h, v)) ... // visited before (v = whatever was stored)
+//   seen.store(h, moveIndex);
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class TranspositionTable {
+public:
+    explicit TranspositionTable(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        m_mask = cap - 1;
+        m_slots.reset(new Slot[cap]);
+        clear();
+    }
+
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    size_t capacity() const { return m_mask + 1; }
+
+    // Thread-safe. True (and `value` set) if `key` is currently stored.
+    bool probe(uint64_t key, uint64_t& value) const
+    {
+        key = remap(key);
+        const Slot& s = m_slots[key & m_mask];
+        uint64_t v = s.value.load(std::memory_order_relaxed);
+        uint64_t check = s.check.load(std::memory_order_relaxed);
+        if ((check ^ v) != key) return false;
+        value = v;
+        return true;
+    }
+
+    // Thread-safe. Replaces whatever entry held the slot.
+    void store(uint64_t key, uint64_t value)
+    {
+        key = remap(key);
+        Slot& s = m_slots[key & m_mask];
+        s.check.store(key ^ value, std::memory_order_relaxed);
+        s.value.store(value, std::memory_order_relaxed);
+    }
+
+    // Not thread-safe: empties every slot.
+    void clear()
+    {
+        for (size_t i = 0; i <= m_mask; ++i) {
+            m_slots[i].check.store(0, std::memory_order_relaxed);
+            m_slots[i].value.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> check; // key ^ value
+        std::atomic<uint64_t> value;
+    };
+
+    // an empty slot reads as key 0, so key 0 is stored as another (equally unlikely) key
+    static uint64_t remap(uint64_t key) { return key ? key : 0x9E3779B97F4A7C15ull; }
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask = 0;
+};
+
+#endif // TRANSPOSITION_TABLE_H
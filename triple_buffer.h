@@ -0,0 +1,52 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// TripleBuffer - lock-free single-producer / single-consumer "latest value" channel
+// - The producer fills writeBuffer() and publish()es it; the consumer calls fetch() and
+//   reads readBuffer(). Neither side ever waits for the other.
+// - Three slots: one owned by each side plus a middle slot exchanged atomically, so the
+//   consumer always sees a complete value and skips intermediate ones it was too slow for
+// - Slots are copies of the prototype passed to the constructor, so presized containers
+//   never reallocate afterwards
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer {
+public:
+    explicit TripleBuffer(const T& prototype = T())
+        : m_slots{prototype, prototype, prototype} {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side
+    T& writeBuffer() { return m_slots[m_write]; }
+    void publish()
+    {
+        uint8_t prev = m_middle.exchange((uint8_t)(m_write | FRESH), std::memory_order_acq_rel);
+        m_write = prev & INDEX;
+    }
+
+    // Consumer side: switch to the newest published value. Returns false if nothing new.
+    bool fetch()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        uint8_t prev = m_middle.exchange(m_read, std::memory_order_acq_rel);
+        m_read = prev & INDEX;
+        return true;
+    }
+    const T& readBuffer() const { return m_slots[m_read]; }
+
+private:
+    static const uint8_t INDEX = 0x3;
+    static const uint8_t FRESH = 0x4; // middle slot holds a value the consumer hasn't taken
+
+    T m_slots[3];
+    std::atomic<uint8_t> m_middle{1};
+    uint8_t m_write = 0; // producer only
+    uint8_t m_read = 2;  // consumer only
+};
+
+#endif // TRIPLE_BUFFER_H
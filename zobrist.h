@@ -0,0 +1,32 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+// Zobrist keys for cube states
+// - A state's hash is the XOR over all facelet positions of key(size, position, color), with
+//   positions numbered as Core's stickers (face * N*N + row-major cell, faces U R F D L B) and
+//   colors 0..5 in the same face order
+// - Keys are derived from their index by a 64-bit mixer (splitmix64) instead of a random
+//   table, so every cube size gets its own keys without storage and every engine agrees:
+//   CubieCube::hash(), FaceletCube::hash() and Core::stateHash() are equal for one 3x3 state
+// - A turn changes the hash by XOR-ing out the moved stickers' old keys and XOR-ing in the new
+//   ones, so engines keep it up to date at O(stickers moved) per turn
+//
+// No GL and no GLM here.
+
+#include <cstdint>
+
+inline uint64_t zobristMix(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// key of color `color` (0..5) showing at facelet `position` of a size x size cube
+inline uint64_t zobristKey(int size, int position, int color)
+{
+    return zobristMix(((uint64_t)size << 32) | (uint64_t)(position * 6 + color));
+}
+
+#endif // ZOBRIST_H